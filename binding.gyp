@@ -4,16 +4,31 @@
             "target_name": "multihashing",
             "sources": [
                 "multihashing.cc",
-                "cryptonight.c",
-                "cryptonight_light.c",
+                "cryptonight.cc",
+                "cryptonight_soft.cc",
+                "cryptonight_aesni.cc",
+                "cryptonight_avx2.cc",
+                "cryptonight_avx512.cc",
+                "hash_dispatch.c",
+                "share_check.c",
+                "block_template.c",
+                "nonce_scan.c",
+                "cryptonight_stats.c",
+                "cn_workers.c",
+                "hash_pool.c",
+                "prio_queue.c",
+                "cryptonight_scratchpad.c",
+                "cpu_features.c",
                 "sha3/sph_keccak.c",
                 "crypto/oaes_lib.c",
                 "crypto/c_keccak.c",
                 "crypto/c_groestl.c",
+                "crypto/groestl_aesni.c",
                 "crypto/c_blake256.c",
                 "crypto/c_jh.c",
                 "crypto/c_skein.c",
                 "crypto/hash.c",
+                "crypto/tree-hash.c",
                 "crypto/aesb.c"
             ],
             "include_dirs": [
@@ -21,7 +36,7 @@
                 "<!(node -e \"require('nan')\")",
             ],
 			"cflags_c": [
-				"-std=gnu11 -march=native -fPIC -m64"
+				"-std=gnu11 -fPIC -m64"
 			],
             "cflags_cc": [
                 "-std=gnu++11 -fPIC -m64"
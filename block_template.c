@@ -0,0 +1,169 @@
+// Block templates parsed once per job, so shares only patch bytes.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "block_template.h"
+#include "crypto/hash-ops.h"
+
+static int read_varint(const uint8_t **p, const uint8_t *end, uint64_t *value) {
+    uint64_t v = 0;
+    int shift;
+
+    for (shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t b = *(*p)++;
+
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            *value = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static size_t write_varint(uint8_t *out, uint64_t value) {
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+// Version 1 txs hash their blob; later ones hash the hashes of the prefix,
+// the RingCT base (just the type for a miner tx) and the empty prunable part.
+static void miner_tx_hash(const struct block_template *bt, char *hash) {
+    const uint8_t *tx = bt->blob + bt->miner_tx_offset;
+    char parts[3][HASH_SIZE];
+
+    if (bt->miner_tx_version < 2) {
+        cn_fast_hash(tx, bt->miner_tx_size, hash);
+        return;
+    }
+    cn_fast_hash(tx, bt->miner_tx_prefix_size, parts[0]);
+    cn_fast_hash(tx + bt->miner_tx_prefix_size, bt->miner_tx_size - bt->miner_tx_prefix_size, parts[1]);
+    memset(parts[2], 0, HASH_SIZE);
+    cn_fast_hash(parts, sizeof(parts), hash);
+}
+
+static void update_root(struct block_template *bt) {
+    char leaf[HASH_SIZE];
+
+    miner_tx_hash(bt, leaf);
+    tree_hash_from_branch((const char (*)[HASH_SIZE])bt->branch, bt->depth, leaf,
+                          (char *)bt->hashing_blob + bt->nonce_offset + 4);
+}
+
+// Miner tx: version, unlock time, one txin_gen, outputs to keys, extra and,
+// from version 2 on, the RingCT type (which must be RCTTypeNull).
+static const char *parse_miner_tx(struct block_template *bt, const uint8_t **p, const uint8_t *end) {
+    const uint8_t *start = *p;
+    uint64_t version, value, outputs, extra, i;
+
+    if (!read_varint(p, end, &version) || !read_varint(p, end, &value))
+        return "Truncated miner transaction.";
+    if (!read_varint(p, end, &value) || value != 1 || *p >= end || *(*p)++ != 0xff || !read_varint(p, end, &value))
+        return "Miner transaction should have a single coinbase input.";
+    if (!read_varint(p, end, &outputs))
+        return "Truncated miner transaction.";
+    for (i = 0; i < outputs; i++) {
+        size_t key;
+
+        if (!read_varint(p, end, &value) || *p >= end)
+            return "Truncated miner transaction.";
+        switch (*(*p)++) {
+        case 0x02: key = 32; break;     /* txout_to_key */
+        case 0x03: key = 33; break;     /* txout_to_tagged_key */
+        default: return "Unsupported miner transaction output.";
+        }
+        if ((size_t)(end - *p) < key)
+            return "Truncated miner transaction.";
+        *p += key;
+    }
+    if (!read_varint(p, end, &extra) || extra > (uint64_t)(end - *p))
+        return "Truncated miner transaction.";
+    bt->extra_offset = *p - bt->blob;
+    bt->extra_size = extra;
+    *p += extra;
+    bt->miner_tx_prefix_size = *p - start;
+    if (version >= 2) {
+        if (*p >= end || **p != 0)
+            return "Miner transaction should have no RingCT signatures.";
+        (*p)++;
+    }
+    bt->miner_tx_version = version;
+    bt->miner_tx_offset = start - bt->blob;
+    bt->miner_tx_size = *p - start;
+    return NULL;
+}
+
+const char *block_template_init(struct block_template *bt, const uint8_t *blob, size_t size) {
+    const uint8_t *p, *end;
+    const char *error;
+    uint64_t value, count;
+    char (*hashes)[HASH_SIZE];
+    size_t header;
+
+    memset(bt, 0, sizeof(*bt));
+    bt->blob = malloc(size ? size : 1);
+    bt->size = size;
+    memcpy(bt->blob, blob, size);
+    p = bt->blob;
+    end = p + size;
+
+    // major and minor version, timestamp, previous block id and nonce
+    if (!read_varint(&p, end, &value) || !read_varint(&p, end, &value) || !read_varint(&p, end, &value) ||
+        end - p < HASH_SIZE + 4)
+        return "Truncated block header.";
+    p += HASH_SIZE;
+    bt->nonce_offset = p - bt->blob;
+    p += 4;
+    header = p - bt->blob;
+
+    if ((error = parse_miner_tx(bt, &p, end)) != NULL)
+        return error;
+    if (!read_varint(&p, end, &count) || count > (uint64_t)(end - p) / HASH_SIZE)
+        return "Truncated transaction hashes.";
+    if ((uint64_t)(end - p) != count * HASH_SIZE)
+        return "Unexpected data after the transaction hashes.";
+
+    // leaf 0 is the miner tx, which tree_branch never looks at
+    hashes = malloc((count + 1) * HASH_SIZE);
+    memcpy(hashes + 1, p, count * HASH_SIZE);
+    bt->depth = tree_branch((const char (*)[HASH_SIZE])hashes, count + 1, bt->branch);
+    free(hashes);
+
+    bt->hashing_blob = malloc(header + HASH_SIZE + 10);
+    memcpy(bt->hashing_blob, bt->blob, header);
+    bt->hashing_blob_size = header + HASH_SIZE + write_varint(bt->hashing_blob + header + HASH_SIZE, count + 1);
+    update_root(bt);
+    return NULL;
+}
+
+void block_template_free(struct block_template *bt) {
+    free(bt->blob);
+    free(bt->hashing_blob);
+    bt->blob = NULL;
+    bt->hashing_blob = NULL;
+}
+
+int block_template_set_reserved(struct block_template *bt, size_t offset, const uint8_t *data, size_t len) {
+    if (offset < bt->extra_offset || offset > bt->extra_offset + bt->extra_size ||
+        len > bt->extra_offset + bt->extra_size - offset)
+        return 0;
+    if (memcmp(bt->blob + offset, data, len) == 0)
+        return 1;
+    memcpy(bt->blob + offset, data, len);
+    update_root(bt);
+    return 1;
+}
+
+void block_template_set_nonce(struct block_template *bt, uint32_t nonce) {
+    uint8_t le[4] = { (uint8_t)nonce, (uint8_t)(nonce >> 8), (uint8_t)(nonce >> 16), (uint8_t)(nonce >> 24) };
+
+    memcpy(bt->blob + bt->nonce_offset, le, 4);
+    memcpy(bt->hashing_blob + bt->nonce_offset, le, 4);
+}
@@ -0,0 +1,52 @@
+#ifndef BLOCK_TEMPLATE_H
+#define BLOCK_TEMPLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A CryptoNote block template (header, miner tx, tx hashes) kept together
+ * with its hashing blob, get_block_hashing_blob(): header, tx tree root and
+ * tx count. Patching the reserved bytes of the miner tx updates the root
+ * through the cached sibling path of the miner tx (tree_branch), so neither
+ * the tree nor the blob is rebuilt per extra nonce.
+ */
+struct block_template {
+    uint8_t *blob;              /* the block, patched in place */
+    size_t size;
+    size_t nonce_offset;        /* same in the block and the hashing blob */
+    size_t miner_tx_offset;
+    size_t miner_tx_size;
+    size_t miner_tx_prefix_size;    /* without the RingCT type (version 2+) */
+    uint64_t miner_tx_version;
+    size_t extra_offset;        /* the miner tx extra field, in the block */
+    size_t extra_size;
+    size_t depth;
+    char branch[8 * sizeof(size_t)][32];
+    uint8_t *hashing_blob;
+    size_t hashing_blob_size;
+};
+
+/* Parses and copies blob. Returns NULL or what is wrong with the blob. */
+const char *block_template_init(struct block_template *bt, const uint8_t *blob, size_t size);
+void block_template_free(struct block_template *bt);
+
+/*
+ * Writes len bytes at offset (in the block) and updates the tx tree root of
+ * the hashing blob. The bytes must lie in the miner tx extra field; returns
+ * 0 if they do not.
+ */
+int block_template_set_reserved(struct block_template *bt, size_t offset, const uint8_t *data, size_t len);
+
+/* Stores the nonce (little-endian) in the block and the hashing blob. */
+void block_template_set_nonce(struct block_template *bt, uint32_t nonce);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,288 @@
+// Hashing workers pinned per NUMA node, each with node-local scratchpads.
+// Topology comes from sysfs; without it everything runs as node 0.
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cn_workers.h"
+#include "cryptonight_scratchpad.h"
+
+#define NODE_PATH "/sys/devices/system/node"
+
+struct cn_node {
+    int id;
+    cpu_set_t cpus;
+    uint32_t workers;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    struct cn_work *head, *tail;
+    uint64_t jobs;
+    uint64_t hashes;
+    uint64_t busy_ns;
+};
+
+struct cn_worker {
+    struct cn_node *node;
+    pthread_t thread;
+};
+
+static pthread_mutex_t workers_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cn_node *nodes = NULL;
+static uint32_t node_count = 0;
+static uint32_t next_node = 0;
+static int running = 0;
+static void (*completed_notify)(void) = NULL;
+
+static pthread_mutex_t completed_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cn_work *completed_head = NULL, *completed_tail = NULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Parses a sysfs cpulist such as "0-7,16-23" into `set`. */
+static void parse_cpulist(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    while (*list != '\0' && *list != '\n') {
+        char *end;
+        long first = strtol(list, &end, 10), last = first, cpu;
+
+        if (end == list)
+            break;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        for (cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, set);
+        list = *end == ',' ? end + 1 : end;
+    }
+}
+
+static int read_node_cpus(int id, cpu_set_t *set) {
+    char path[128], list[4096];
+    FILE *f;
+
+    snprintf(path, sizeof(path), NODE_PATH "/node%d/cpulist", id);
+    f = fopen(path, "r");
+    if (f == NULL)
+        return 0;
+    if (fgets(list, sizeof(list), f) == NULL)
+        list[0] = '\0';
+    fclose(f);
+
+    parse_cpulist(list, set);
+    return CPU_COUNT(set) > 0;
+}
+
+static uint32_t detect_nodes(void) {
+    DIR *dir = opendir(NODE_PATH);
+    struct dirent *entry;
+    cpu_set_t allowed, cpus;
+    uint32_t count = 0;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        int id;
+        char tail;
+
+        if (sscanf(entry->d_name, "node%d%c", &id, &tail) != 1 || !read_node_cpus(id, &cpus))
+            continue;
+        // Only the CPUs this process may run on (cgroups, taskset)
+        CPU_AND(&cpus, &cpus, &allowed);
+        if (CPU_COUNT(&cpus) == 0)
+            continue;
+
+        nodes = realloc(nodes, (count + 1) * sizeof(struct cn_node));
+        if (nodes == NULL)
+            abort();
+        memset(&nodes[count], 0, sizeof(struct cn_node));
+        nodes[count].id = id;
+        nodes[count].cpus = cpus;
+        count++;
+    }
+    if (dir != NULL)
+        closedir(dir);
+
+    if (count == 0) {
+        nodes = calloc(1, sizeof(struct cn_node));
+        if (nodes == NULL)
+            abort();
+        nodes[0].cpus = allowed;
+        count = 1;
+    }
+    return count;
+}
+
+static void complete(struct cn_work *work) {
+    work->next = NULL;
+    pthread_mutex_lock(&completed_lock);
+    if (completed_tail != NULL)
+        completed_tail->next = work;
+    else
+        completed_head = work;
+    completed_tail = work;
+    pthread_mutex_unlock(&completed_lock);
+
+    completed_notify();
+}
+
+static void *worker_main(void *data) {
+    struct cn_worker *worker = data;
+    struct cn_node *node = worker->node;
+
+    pthread_setaffinity_np(pthread_self(), sizeof(node->cpus), &node->cpus);
+    cn_scratchpad_set_node(node->id);
+
+    for (;;) {
+        struct cn_work *work;
+        uint64_t start;
+        uint32_t hashes;
+        int last;
+
+        pthread_mutex_lock(&node->lock);
+        while (node->head == NULL)
+            pthread_cond_wait(&node->ready, &node->lock);
+        work = node->head;
+        work->active++;
+        pthread_mutex_unlock(&node->lock);
+
+        start = now_ns();
+        hashes = work->run(work);
+
+        // Once any run() returns the job is drained: stop handing it out
+        pthread_mutex_lock(&node->lock);
+        if (node->head == work) {
+            node->head = work->next;
+            if (node->head == NULL)
+                node->tail = NULL;
+            node->jobs++;
+        }
+        last = --work->active == 0;
+        node->hashes += hashes;
+        node->busy_ns += now_ns() - start;
+        pthread_mutex_unlock(&node->lock);
+
+        if (last)
+            complete(work);
+    }
+    return NULL;
+}
+
+uint32_t cn_workers_start(uint32_t per_node, void (*notify)(void)) {
+    uint32_t n, i, total = 0;
+
+    pthread_mutex_lock(&workers_lock);
+    if (running) {
+        for (n = 0; n < node_count; n++)
+            total += nodes[n].workers;
+        pthread_mutex_unlock(&workers_lock);
+        return total;
+    }
+
+    completed_notify = notify;
+    node_count = detect_nodes();
+    for (n = 0; n < node_count; n++) {
+        struct cn_node *node = &nodes[n];
+        uint32_t count = per_node != 0 ? per_node : (uint32_t)CPU_COUNT(&node->cpus);
+
+        pthread_mutex_init(&node->lock, NULL);
+        pthread_cond_init(&node->ready, NULL);
+        for (i = 0; i < count; i++) {
+            struct cn_worker *worker = calloc(1, sizeof(struct cn_worker));
+
+            if (worker == NULL)
+                break;
+            worker->node = node;
+            if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+                free(worker);
+                break;
+            }
+            pthread_detach(worker->thread);
+            node->workers++;
+        }
+        total += node->workers;
+    }
+    running = total > 0;
+    if (!running) {
+        // Nothing started: drop the topology so a retry begins afresh
+        for (n = 0; n < node_count; n++) {
+            pthread_mutex_destroy(&nodes[n].lock);
+            pthread_cond_destroy(&nodes[n].ready);
+        }
+        free(nodes);
+        nodes = NULL;
+        node_count = 0;
+    }
+    pthread_mutex_unlock(&workers_lock);
+    return total;
+}
+
+int cn_workers_running(void) {
+    return running;
+}
+
+void cn_workers_submit(struct cn_work *work) {
+    struct cn_node *node;
+
+    // Nodes without a worker never drain their queue
+    do {
+        node = &nodes[__atomic_fetch_add(&next_node, 1, __ATOMIC_RELAXED) % node_count];
+    } while (node->workers == 0);
+
+    work->node = node->id;
+    work->active = 0;
+    work->next = NULL;
+
+    pthread_mutex_lock(&node->lock);
+    if (node->tail != NULL)
+        node->tail->next = work;
+    else
+        node->head = work;
+    node->tail = work;
+    pthread_cond_broadcast(&node->ready);
+    pthread_mutex_unlock(&node->lock);
+}
+
+struct cn_work *cn_workers_take_completed(void) {
+    struct cn_work *work;
+
+    pthread_mutex_lock(&completed_lock);
+    work = completed_head;
+    if (work != NULL) {
+        completed_head = work->next;
+        if (completed_head == NULL)
+            completed_tail = NULL;
+    }
+    pthread_mutex_unlock(&completed_lock);
+    return work;
+}
+
+uint32_t cn_workers_report(struct cn_node_info *info, uint32_t max) {
+    uint32_t n;
+
+    for (n = 0; n < node_count && n < max; n++) {
+        struct cn_node *node = &nodes[n];
+
+        pthread_mutex_lock(&node->lock);
+        info[n].node = node->id;
+        info[n].cpus = CPU_COUNT(&node->cpus);
+        info[n].workers = node->workers;
+        info[n].jobs = node->jobs;
+        info[n].hashes = node->hashes;
+        info[n].busy_ns = node->busy_ns;
+        pthread_mutex_unlock(&node->lock);
+    }
+    return node_count;
+}
@@ -0,0 +1,57 @@
+#ifndef CN_WORKERS_H
+#define CN_WORKERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * A job for the NUMA worker pool. Every worker of the job's node calls
+ * run() concurrently until one of them returns (so run() should claim its
+ * pieces of work from a shared counter and return once none are left).
+ * run() returns how many hashes that call did, for the node counters.
+ */
+struct cn_work {
+    uint32_t (*run)(struct cn_work *work);
+    void *data;             /* owner's, untouched by the pool */
+    int node;               /* set by cn_workers_submit */
+    uint32_t active;        /* workers inside run(), guarded by the node lock */
+    struct cn_work *next;
+};
+
+/*
+ * Starts `per_node` pinned workers on every NUMA node (0: one per CPU of
+ * the node). `notify` is called from a worker thread whenever a job has
+ * completed. Returns the number of workers, or 0 if they couldn't start.
+ * Calling it again while running is a no-op.
+ */
+uint32_t cn_workers_start(uint32_t per_node, void (*notify)(void));
+
+/* Non-zero once cn_workers_start succeeded. */
+int cn_workers_running(void);
+
+/* Queues `work` on the next node, round-robin. */
+void cn_workers_submit(struct cn_work *work);
+
+/* Pops one completed job, NULL if there are none. Safe from any thread. */
+struct cn_work *cn_workers_take_completed(void);
+
+struct cn_node_info {
+    int node;
+    uint32_t cpus;
+    uint32_t workers;
+    uint64_t jobs;
+    uint64_t hashes;
+    uint64_t busy_ns;       /* summed over the node's workers */
+};
+
+/* Fills up to `max` entries, returns the number of nodes. */
+uint32_t cn_workers_report(struct cn_node_info *info, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+// cpuid based detection of the instruction sets used by the hashing kernels.
+
+#include <cpuid.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cpu_features.h"
+
+struct cpu_features cpu_features;
+
+static uint64_t xgetbv0(void) {
+    uint32_t eax, edx;
+
+    __asm__ volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static void detect(struct cpu_features *cpu) {
+    unsigned int eax, ebx, ecx, edx;
+    uint64_t xcr0 = 0;
+    int os_avx, os_avx512;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return;
+
+    cpu->ssse3 = (ecx & bit_SSSE3) != 0;
+    cpu->sse41 = (ecx & bit_SSE4_1) != 0;
+    cpu->aes = (ecx & bit_AES) != 0;
+
+    /* The OS has to save the YMM (and ZMM) state across context switches */
+    if (ecx & bit_OSXSAVE)
+        xcr0 = xgetbv0();
+    os_avx = (ecx & bit_AVX) && (xcr0 & 0x06) == 0x06;
+    os_avx512 = os_avx && (xcr0 & 0xe0) == 0xe0;
+
+    if (__get_cpuid_max(0, NULL) < 7)
+        return;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+    cpu->avx2 = os_avx && (ebx & bit_AVX2) != 0;
+    cpu->bmi2 = (ebx & bit_BMI) != 0 && (ebx & bit_BMI2) != 0;
+    cpu->avx512f = os_avx512 && (ebx & bit_AVX512F) != 0;
+    cpu->vaes = os_avx && cpu->aes && (ecx & bit_VAES) != 0;
+}
+
+__attribute__((constructor))
+void cpu_features_init(void) {
+    struct cpu_features cpu;
+
+    memset(&cpu, 0, sizeof(cpu));
+    detect(&cpu);
+
+    if (cpu.aes && cpu.sse41) {
+        cpu.level = CPU_LEVEL_AESNI;
+        if (cpu.avx2 && cpu.bmi2)
+            cpu.level = CPU_LEVEL_AVX2;
+        if (cpu.level == CPU_LEVEL_AVX2 && cpu.avx512f && cpu.vaes)
+            cpu.level = CPU_LEVEL_AVX512;
+    } else {
+        cpu.level = CPU_LEVEL_SSE2;
+    }
+
+    cpu_features = cpu;
+}
+
+const char *cpu_level_name(enum cpu_level level) {
+    switch (level) {
+    case CPU_LEVEL_AESNI: return "aesni";
+    case CPU_LEVEL_AVX2: return "avx2";
+    case CPU_LEVEL_AVX512: return "avx512";
+    default: return "sse2";
+    }
+}
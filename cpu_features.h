@@ -0,0 +1,39 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ISA levels the hashing kernels are built for, lowest first. */
+enum cpu_level {
+    CPU_LEVEL_SSE2 = 0,     /* x86-64 baseline */
+    CPU_LEVEL_AESNI = 1,    /* AES-NI + SSE4.1 */
+    CPU_LEVEL_AVX2 = 2,     /* AVX2 + BMI2 + AES-NI */
+    CPU_LEVEL_AVX512 = 3    /* AVX-512F + VAES */
+};
+
+/* x86 features the hashing kernels can use, with OS register state support checked. */
+struct cpu_features {
+    int ssse3;
+    int sse41;
+    int aes;
+    int avx2;
+    int bmi2;
+    int avx512f;
+    int vaes;
+    enum cpu_level level;
+};
+
+extern struct cpu_features cpu_features;
+
+/* Fills cpu_features from cpuid/xgetbv. Runs at load; safe to call again. */
+void cpu_features_init(void);
+
+const char *cpu_level_name(enum cpu_level level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
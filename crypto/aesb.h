@@ -0,0 +1,18 @@
+// aesb.h
+// Table based AES rounds (Brian Gladman), used when AES-NI is unavailable
+
+#ifndef AESB_H
+#define AESB_H
+
+#include <stdint.h>
+
+// Forward round tables: t_fn[n][x] is MixColumns(SubBytes(x)) rotated by n bytes
+extern const uint32_t t_fn[4][256];
+
+// one AES round (SubBytes, ShiftRows, MixColumns, AddRoundKey), like aesenc
+void aesb_single_round(const uint8_t *in, uint8_t *out, uint8_t *expandedKey);
+
+// ten rounds with consecutive round keys, as used by CryptoNight
+void aesb_pseudo_round(const uint8_t *in, uint8_t *out, uint8_t *expandedKey);
+
+#endif
@@ -26,6 +26,12 @@ void blake224_final(state *, uint8_t *);
 void blake256_hash(uint8_t *, const uint8_t *, uint64_t);
 void blake224_hash(uint8_t *, const uint8_t *, uint64_t);
 
+/* BLAKE-256 of several messages of the same length (in bytes), up to 8 at a time */
+void blake256_hash_multi(uint8_t *const *, const uint8_t *const *, uint64_t, int);
+
+/* picks the SSE4.1 compression and the 4- or 8-lane (AVX2) multi-hash; returns its name */
+const char *blake256_select(int sse41, int avx2);
+
 /* HMAC functions: */
 
 void hmac_blake256_init(hmac_state *, const uint8_t *, uint64_t);
@@ -10,6 +10,7 @@
 
 #include "c_groestl.h"
 #include "groestl_tables.h"
+#include "groestl_aesni.h"
 
 #define P_TYPE 0
 #define Q_TYPE 1
@@ -123,6 +124,11 @@ static void F512(uint32_t *h, const uint32_t *m) {
   uint32_t y[2*COLS512];
   uint32_t z[2*COLS512];
 
+  if (groestl_use_aesni) {
+    groestl512_compress_aesni((uint8_t*)h, (const uint8_t*)m);
+    return;
+  }
+
   for (i = 0; i < 2*COLS512; i++) {
     z[i] = m[i];
     Ptmp[i] = h[i]^m[i];
@@ -182,7 +188,10 @@ static void OutputTransformation(hashState *ctx) {
   uint32_t y[2*COLS512];
   uint32_t z[2*COLS512];
 
-
+	if (groestl_use_aesni) {
+	  groestl512_output_aesni((uint8_t*)ctx->chaining);
+	  return;
+	}
 
 	for (j = 0; j < 2*COLS512; j++) {
 	  temp[j] = ctx->chaining[j];
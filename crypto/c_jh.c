@@ -18,6 +18,13 @@
 #include <stdint.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#define JH_SSE2 1
+#include <x86intrin.h>
+#else
+#define JH_SSE2 0
+#endif
+
 /*typedef unsigned long long uint64;*/
 typedef uint64_t uint64;
 
@@ -45,7 +52,7 @@ const unsigned char JH384_H0[128]={0x48,0x1e,0x3b,0xc6,0xd8,0x13,0x39,0x8a,0x6d,
 const unsigned char JH512_H0[128]={0x6f,0xd1,0x4b,0x96,0x3e,0x0,0xaa,0x17,0x63,0x6a,0x2e,0x5,0x7a,0x15,0xd5,0x43,0x8a,0x22,0x5e,0x8d,0xc,0x97,0xef,0xb,0xe9,0x34,0x12,0x59,0xf2,0xb3,0xc3,0x61,0x89,0x1d,0xa0,0xc1,0x53,0x6f,0x80,0x1e,0x2a,0xa9,0x5,0x6b,0xea,0x2b,0x6d,0x80,0x58,0x8e,0xcc,0xdb,0x20,0x75,0xba,0xa6,0xa9,0xf,0x3a,0x76,0xba,0xf8,0x3b,0xf7,0x1,0x69,0xe6,0x5,0x41,0xe3,0x4a,0x69,0x46,0xb5,0x8a,0x8e,0x2e,0x6f,0xe6,0x5a,0x10,0x47,0xa7,0xd0,0xc1,0x84,0x3c,0x24,0x3b,0x6e,0x71,0xb1,0x2d,0x5a,0xc1,0x99,0xcf,0x57,0xf6,0xec,0x9d,0xb1,0xf8,0x56,0xa7,0x6,0x88,0x7c,0x57,0x16,0xb1,0x56,0xe3,0xc2,0xfc,0xdf,0xe6,0x85,0x17,0xfb,0x54,0x5a,0x46,0x78,0xcc,0x8c,0xdd,0x4b};
 
 /*42 round constants, each round constant is 32-byte (256-bit)*/
-const unsigned char E8_bitslice_roundconstant[42][32]={
+DATA_ALIGN16(const unsigned char E8_bitslice_roundconstant[42][32])={
 {0x72,0xd5,0xde,0xa2,0xdf,0x15,0xf8,0x67,0x7b,0x84,0x15,0xa,0xb7,0x23,0x15,0x57,0x81,0xab,0xd6,0x90,0x4d,0x5a,0x87,0xf6,0x4e,0x9f,0x4f,0xc5,0xc3,0xd1,0x2b,0x40},
 {0xea,0x98,0x3a,0xe0,0x5c,0x45,0xfa,0x9c,0x3,0xc5,0xd2,0x99,0x66,0xb2,0x99,0x9a,0x66,0x2,0x96,0xb4,0xf2,0xbb,0x53,0x8a,0xb5,0x56,0x14,0x1a,0x88,0xdb,0xa2,0x31},
 {0x3,0xa3,0x5a,0x5c,0x9a,0x19,0xe,0xdb,0x40,0x3f,0xb2,0xa,0x87,0xc1,0x44,0x10,0x1c,0x5,0x19,0x80,0x84,0x9e,0x95,0x1d,0x6f,0x33,0xeb,0xad,0x5e,0xe7,0xcd,0xdc},
@@ -149,6 +156,59 @@ HashReturn jh_hash(int hashbitlen, const BitSequence *data,DataLength databitlen
       m2 ^= temp0;                  \
       m6 ^= temp1;
 
+#if JH_SSE2
+
+/*
+   SSE2 E8: each 128-bit row x[i] of the state lives in one register, so the two
+   64-bit halves the scalar code loops over are processed together. SS and L only
+   use C operators, which GCC applies lane-wise to vector types.
+*/
+#define JH_MASK(v)  _mm_set1_epi64x((long long)(v))
+#define JH_SWAPM(x,m,n)  _mm_or_si128(_mm_slli_epi64(_mm_and_si128((x),JH_MASK(m)),(n)), _mm_and_si128(_mm_srli_epi64((x),(n)),JH_MASK(m)))
+
+static inline __m128i jh_swap1(__m128i x)  { return JH_SWAPM(x, 0x5555555555555555ULL, 1); }
+static inline __m128i jh_swap2(__m128i x)  { return JH_SWAPM(x, 0x3333333333333333ULL, 2); }
+static inline __m128i jh_swap4(__m128i x)  { return JH_SWAPM(x, 0x0f0f0f0f0f0f0f0fULL, 4); }
+static inline __m128i jh_swap8(__m128i x)  { return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)); }
+static inline __m128i jh_swap16(__m128i x) { return _mm_or_si128(_mm_slli_epi32(x, 16), _mm_srli_epi32(x, 16)); }
+static inline __m128i jh_swap32(__m128i x) { return _mm_shuffle_epi32(x, 0xb1); }
+static inline __m128i jh_swap64(__m128i x) { return _mm_shuffle_epi32(x, 0x4e); }
+
+/*one round on the row array x: Sbox, MDS and the swapping layer SW on the odd rows*/
+#define JH_ROUND(x,cc0,cc1,SW)  \
+      SS(x[0],x[2],x[4],x[6],x[1],x[3],x[5],x[7],cc0,cc1); \
+      L(x[0],x[2],x[4],x[6],x[1],x[3],x[5],x[7]);         \
+      x[1] = SW(x[1]); x[3] = SW(x[3]); x[5] = SW(x[5]); x[7] = SW(x[7]);
+
+/*seven rounds starting at round r, with the constants loaded through LOAD*/
+#define JH_ROUNDS7(x,r,LOAD,P)  \
+      JH_ROUND(x, LOAD(r,0), LOAD(r,1), P##swap1);  \
+      JH_ROUND(x, LOAD(r+1,0), LOAD(r+1,1), P##swap2);  \
+      JH_ROUND(x, LOAD(r+2,0), LOAD(r+2,1), P##swap4);  \
+      JH_ROUND(x, LOAD(r+3,0), LOAD(r+3,1), P##swap8);  \
+      JH_ROUND(x, LOAD(r+4,0), LOAD(r+4,1), P##swap16); \
+      JH_ROUND(x, LOAD(r+5,0), LOAD(r+5,1), P##swap32); \
+      JH_ROUND(x, LOAD(r+6,0), LOAD(r+6,1), P##swap64);
+
+#define JH_RC128(r,h)  _mm_load_si128((const __m128i*)E8_bitslice_roundconstant[r] + (h))
+
+/*The bijective function E8, SSE2 form*/
+static void E8(hashState *state)
+{
+      __m128i x[8], temp0, temp1;
+      int i, roundnumber;
+
+      for (i = 0; i < 8; i++)  x[i] = _mm_load_si128((const __m128i*)state->x[i]);
+
+      for (roundnumber = 0; roundnumber < 42; roundnumber = roundnumber+7) {
+            JH_ROUNDS7(x, roundnumber, JH_RC128, jh_);
+      }
+
+      for (i = 0; i < 8; i++)  _mm_store_si128((__m128i*)state->x[i], x[i]);
+}
+
+#else
+
 /*The bijective function E8, in bitslice form*/
 static void E8(hashState *state)
 {
@@ -210,19 +270,24 @@ static void E8(hashState *state)
 
 }
 
+#endif
+
 /*The compression function F8 */
 static void F8(hashState *state)
 {
-      uint64  i;
+      uint64  i, m[8];
+
+      /*copied out rather than read through a uint64 pointer: buffer is a byte array*/
+      memcpy(m, state->buffer, 64);
 
       /*xor the 512-bit message with the fist half of the 1024-bit hash state*/
-      for (i = 0; i < 8; i++)  state->x[i >> 1][i & 1] ^= ((uint64*)state->buffer)[i];
+      for (i = 0; i < 8; i++)  state->x[i >> 1][i & 1] ^= m[i];
 
       /*the bijective function E8 */
       E8(state);
 
       /*xor the 512-bit message with the second half of the 1024-bit hash state*/
-      for (i = 0; i < 8; i++)  state->x[(8+i) >> 1][(8+i) & 1] ^= ((uint64*)state->buffer)[i];
+      for (i = 0; i < 8; i++)  state->x[(8+i) >> 1][(8+i) & 1] ^= m[i];
 }
 
 /*before hashing a message, initialize the hash state as H0 */
@@ -365,3 +430,159 @@ HashReturn jh_hash(int hashbitlen, const BitSequence *data,DataLength databitlen
       else
             return(BAD_HASHLEN);
 }
+
+#if JH_SSE2
+
+int jh_use_avx2 = 0;
+
+/*
+   AVX2 E8 for several messages: one 256-bit register holds the same row of two
+   states, and the 4-lane form runs two such register sets round by round.
+*/
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+#define JH_MASK256(v)  _mm256_set1_epi64x((long long)(v))
+#define JH_SWAPM256(x,m,n)  _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256((x),JH_MASK256(m)),(n)), _mm256_and_si256(_mm256_srli_epi64((x),(n)),JH_MASK256(m)))
+
+static inline __m256i jh2_swap1(__m256i x)  { return JH_SWAPM256(x, 0x5555555555555555ULL, 1); }
+static inline __m256i jh2_swap2(__m256i x)  { return JH_SWAPM256(x, 0x3333333333333333ULL, 2); }
+static inline __m256i jh2_swap4(__m256i x)  { return JH_SWAPM256(x, 0x0f0f0f0f0f0f0f0fULL, 4); }
+static inline __m256i jh2_swap8(__m256i x)  { return _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8)); }
+static inline __m256i jh2_swap16(__m256i x) { return _mm256_or_si256(_mm256_slli_epi32(x, 16), _mm256_srli_epi32(x, 16)); }
+static inline __m256i jh2_swap32(__m256i x) { return _mm256_shuffle_epi32(x, 0xb1); }
+static inline __m256i jh2_swap64(__m256i x) { return _mm256_shuffle_epi32(x, 0x4e); }
+
+#define JH_RC256(r,h)  _mm256_broadcastsi128_si256(JH_RC128(r,h))
+
+/*the same round on both register sets x[0..7] and x[8..15]*/
+#define JH_ROUND_X2(x,cc0,cc1,SW)  { \
+      __m256i k0 = (cc0), k1 = (cc1);  \
+      JH_ROUND(x, k0, k1, SW);         \
+      JH_ROUND((x+8), k0, k1, SW);     \
+}
+
+static void E8_x2(__m256i x[8])
+{
+      __m256i temp0, temp1;
+      int roundnumber;
+
+      for (roundnumber = 0; roundnumber < 42; roundnumber = roundnumber+7) {
+            JH_ROUNDS7(x, roundnumber, JH_RC256, jh2_);
+      }
+}
+
+static void E8_x4(__m256i x[16])
+{
+      __m256i temp0, temp1;
+      int r;
+
+      for (r = 0; r < 42; r = r+7) {
+            JH_ROUND_X2(x, JH_RC256(r,0), JH_RC256(r,1), jh2_swap1);
+            JH_ROUND_X2(x, JH_RC256(r+1,0), JH_RC256(r+1,1), jh2_swap2);
+            JH_ROUND_X2(x, JH_RC256(r+2,0), JH_RC256(r+2,1), jh2_swap4);
+            JH_ROUND_X2(x, JH_RC256(r+3,0), JH_RC256(r+3,1), jh2_swap8);
+            JH_ROUND_X2(x, JH_RC256(r+4,0), JH_RC256(r+4,1), jh2_swap16);
+            JH_ROUND_X2(x, JH_RC256(r+5,0), JH_RC256(r+5,1), jh2_swap32);
+            JH_ROUND_X2(x, JH_RC256(r+6,0), JH_RC256(r+6,1), jh2_swap64);
+      }
+}
+
+static inline __m256i jh2_load(const unsigned char *lo, const unsigned char *hi)
+{
+      return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)lo)), _mm_loadu_si128((const __m128i*)hi), 1);
+}
+
+/*the k-th padded 512-bit block of a byte-aligned message of len bytes, as Update and Final form it*/
+static void jh_block(const BitSequence *data, size_t len, size_t k, unsigned char *block)
+{
+      size_t full = len >> 6, rem = len & 63;
+      DataLength bits = (DataLength)len << 3;
+      int i;
+
+      if (k < full) {
+            memcpy(block, data + (k << 6), 64);
+            return;
+      }
+      memset(block, 0, 64);
+      if (k == full && rem != 0) {
+            memcpy(block, data + (full << 6), rem);
+            block[rem] = 0x80;
+            return;
+      }
+      if (rem == 0)
+            block[0] = 0x80;
+      for (i = 0; i < 8; i++)  block[63 - i] = (bits >> (8 * i)) & 0xff;
+}
+
+/*JH-256 of 2 to 4 messages of len bytes; lanes past count repeat the last message*/
+static void jh256_hash_x4(const BitSequence *const *data, size_t len, BitSequence *const *hashval, int count)
+{
+      DATA_ALIGN16(unsigned char block[4][64]);
+      const BitSequence *in[4];
+      size_t nblocks = (len >> 6) + ((len & 63) ? 2 : 1), k;
+      int sets = count > 2 ? 2 : 1, lane, i;
+      __m256i x[16], m[8];
+
+      for (lane = 0; lane < 4; lane++)  in[lane] = data[lane < count ? lane : count - 1];
+
+      for (i = 0; i < 8; i++)  x[i] = x[8+i] = jh2_load(JH256_H0 + 16*i, JH256_H0 + 16*i);
+
+      for (k = 0; k < nblocks; k++) {
+            for (lane = 0; lane < 2*sets; lane++)  jh_block(in[lane], len, k, block[lane]);
+            for (i = 0; i < 4*sets; i++) {
+                  m[i] = jh2_load(block[(i >> 2) << 1] + 16*(i & 3), block[((i >> 2) << 1) + 1] + 16*(i & 3));
+                  x[(i >> 2)*8 + (i & 3)] ^= m[i];
+            }
+            if (sets == 2)
+                  E8_x4(x);
+            else
+                  E8_x2(x);
+            for (i = 0; i < 4*sets; i++)  x[(i >> 2)*8 + 4 + (i & 3)] ^= m[i];
+      }
+
+      for (lane = 0; lane < count; lane++) {
+            __m256i *r = x + 8*(lane >> 1);
+            if (lane & 1) {
+                  _mm_storeu_si128((__m128i*)hashval[lane], _mm256_extracti128_si256(r[6], 1));
+                  _mm_storeu_si128((__m128i*)(hashval[lane] + 16), _mm256_extracti128_si256(r[7], 1));
+            } else {
+                  _mm_storeu_si128((__m128i*)hashval[lane], _mm256_castsi256_si128(r[6]));
+                  _mm_storeu_si128((__m128i*)(hashval[lane] + 16), _mm256_castsi256_si128(r[7]));
+            }
+      }
+}
+
+#pragma GCC pop_options
+
+#endif
+
+const char *jh_select(int avx2)
+{
+#if JH_SSE2
+      jh_use_avx2 = avx2 != 0;
+      return jh_use_avx2 ? "avx2" : "sse2";
+#else
+      (void)avx2;
+      return "generic";
+#endif
+}
+
+void jh256_hash_multi(const BitSequence *const *data, size_t len, BitSequence *const *hashval, int count)
+{
+      while (count > 0) {
+            int n = count < 4 ? count : 4, i;
+
+#if JH_SSE2
+            if (jh_use_avx2 && n > 1)
+                  jh256_hash_x4(data, len, hashval, n);
+            else
+#endif
+            for (i = 0; i < n; i++)
+                  jh_hash(256, data[i], (DataLength)len << 3, hashval[i]);
+
+            data += n;
+            hashval += n;
+            count -= n;
+      }
+}
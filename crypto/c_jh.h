@@ -18,3 +18,9 @@
 typedef enum {SUCCESS = 0, FAIL = 1, BAD_HASHLEN = 2} HashReturn;
 
 HashReturn jh_hash(int hashbitlen, const BitSequence *data, DataLength databitlen, BitSequence *hashval);
+
+/* picks the E8 used by jh256_hash_multi (4 states at a time with AVX2), returns its name */
+const char *jh_select(int avx2);
+
+/* JH-256 of count messages that are all len bytes long */
+void jh256_hash_multi(const BitSequence *const *data, size_t len, BitSequence *const *hashval, int count);
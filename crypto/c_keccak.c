@@ -31,7 +31,7 @@ const int keccakf_piln[24] =
 
 // update the state with given number of rounds
 
-void keccakf(uint64_t st[25], int rounds)
+static inline __attribute__((always_inline)) void keccakf_rounds(uint64_t st[25], int rounds)
 {
     int i, j, round;
     uint64_t t, bc[5];
@@ -70,6 +70,31 @@ void keccakf(uint64_t st[25], int rounds)
     }
 }
 
+static void keccakf_generic(uint64_t st[25], int rounds)
+{
+    keccakf_rounds(st, rounds);
+}
+
+// Same code; BMI1/BMI2 let the compiler use andn for chi and rorx for rho
+__attribute__((target("bmi,bmi2")))
+static void keccakf_bmi2(uint64_t st[25], int rounds)
+{
+    keccakf_rounds(st, rounds);
+}
+
+static void (*keccakf_impl)(uint64_t st[25], int rounds) = keccakf_generic;
+
+void keccakf(uint64_t st[25], int rounds)
+{
+    keccakf_impl(st, rounds);
+}
+
+const char *keccakf_select(int bmi2)
+{
+    keccakf_impl = bmi2 ? keccakf_bmi2 : keccakf_generic;
+    return bmi2 ? "bmi2" : "generic";
+}
+
 // compute a keccak hash (md) of given byte length from "in"
 typedef uint64_t state_t[25];
 
@@ -110,3 +135,154 @@ void keccak1600(const uint8_t *in, int inlen, uint8_t *md)
 {
     keccak(in, inlen, md, sizeof(state_t));
 }
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+// Keccak-f[1600] on several states at once, one state per 64-bit vector lane.
+// KECCAKF_LANES instantiates the permutation with rho and pi written out, and
+// a keccak1600 sponge that keeps every lane busy: when a message is absorbed
+// its lane is cleared and takes the next one, so messages of different
+// lengths share the permutations.
+
+#define KECCAKF_RHOPI(j, r)  bc[0] = st[j]; st[j] = ROTL64(t, r); t = bc[0];
+
+#define KECCAKF_LANES(name, vec, lanes)                                     \
+static void name##_f(vec st[25])                                            \
+{                                                                           \
+    vec t, bc[5];                                                           \
+    int i, j, round;                                                        \
+                                                                            \
+    for (round = 0; round < KECCAK_ROUNDS; round++) {                       \
+        for (i = 0; i < 5; i++)                                             \
+            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20]; \
+        for (i = 0; i < 5; i++) {                                           \
+            t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);               \
+            for (j = 0; j < 25; j += 5)                                     \
+                st[j + i] ^= t;                                             \
+        }                                                                   \
+                                                                            \
+        t = st[1];                                                          \
+        KECCAKF_RHOPI(10,  1) KECCAKF_RHOPI( 7,  3) KECCAKF_RHOPI(11,  6)   \
+        KECCAKF_RHOPI(17, 10) KECCAKF_RHOPI(18, 15) KECCAKF_RHOPI( 3, 21)   \
+        KECCAKF_RHOPI( 5, 28) KECCAKF_RHOPI(16, 36) KECCAKF_RHOPI( 8, 45)   \
+        KECCAKF_RHOPI(21, 55) KECCAKF_RHOPI(24,  2) KECCAKF_RHOPI( 4, 14)   \
+        KECCAKF_RHOPI(15, 27) KECCAKF_RHOPI(23, 41) KECCAKF_RHOPI(19, 56)   \
+        KECCAKF_RHOPI(13,  8) KECCAKF_RHOPI(12, 25) KECCAKF_RHOPI( 2, 43)   \
+        KECCAKF_RHOPI(20, 62) KECCAKF_RHOPI(14, 18) KECCAKF_RHOPI(22, 39)   \
+        KECCAKF_RHOPI( 9, 61) KECCAKF_RHOPI( 6, 20) KECCAKF_RHOPI( 1, 44)   \
+                                                                            \
+        for (j = 0; j < 25; j += 5) {                                       \
+            for (i = 0; i < 5; i++)                                         \
+                bc[i] = st[j + i];                                          \
+            for (i = 0; i < 5; i++)                                         \
+                st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];          \
+        }                                                                   \
+                                                                            \
+        st[0] ^= keccakf_rndc[round];                                       \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static void name(const uint8_t *const *in, const size_t *inlen,             \
+                 uint8_t *const *md, int mdlen, int count)                  \
+{                                                                           \
+    vec st[25];                                                             \
+    uint64_t w[25];                                                         \
+    uint8_t temp[HASH_DATA_AREA];                                           \
+    size_t pos[lanes];                                                      \
+    int job[lanes], next = 0, busy = 0, i, j;                               \
+                                                                            \
+    memset(st, 0, sizeof(st));                                              \
+    for (j = 0; j < lanes; j++) {                                           \
+        job[j] = next < count ? next++ : -1;                                \
+        pos[j] = 0;                                                         \
+        busy += job[j] >= 0;                                                \
+    }                                                                       \
+                                                                            \
+    while (busy) {                                                          \
+        for (j = 0; j < lanes; j++) {                                       \
+            const uint8_t *src;                                             \
+            size_t left;                                                    \
+                                                                            \
+            if (job[j] < 0)                                                 \
+                continue;                                                   \
+            src = in[job[j]] + pos[j];                                      \
+            left = inlen[job[j]] - pos[j];                                  \
+            if (left < HASH_DATA_AREA) {                                    \
+                memcpy(temp, src, left);                                    \
+                temp[left] = 1;                                             \
+                memset(temp + left + 1, 0, HASH_DATA_AREA - left - 1);      \
+                temp[HASH_DATA_AREA - 1] |= 0x80;                           \
+                src = temp;                                                 \
+            }                                                               \
+            memcpy(w, src, HASH_DATA_AREA);                                 \
+            for (i = 0; i < HASH_DATA_AREA / 8; i++)                        \
+                st[i][j] ^= w[i];                                           \
+            pos[j] += HASH_DATA_AREA;                                       \
+        }                                                                   \
+                                                                            \
+        name##_f(st);                                                       \
+                                                                            \
+        /* a lane whose last (padded) block went in is done */             \
+        for (j = 0; j < lanes; j++) {                                       \
+            if (job[j] < 0 || pos[j] <= inlen[job[j]])                      \
+                continue;                                                   \
+            for (i = 0; i < 25; i++) {                                      \
+                w[i] = st[i][j];                                            \
+                st[i][j] = 0;                                               \
+            }                                                               \
+            memcpy(md[job[j]], w, mdlen);                                   \
+            job[j] = next < count ? next++ : -1;                            \
+            pos[j] = 0;                                                     \
+            busy -= job[j] < 0;                                             \
+        }                                                                   \
+    }                                                                       \
+}
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+typedef uint64_t keccak_v4 __attribute__((vector_size(32)));
+KECCAKF_LANES(keccak1600_x4, keccak_v4, 4)
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+typedef uint64_t keccak_v8 __attribute__((vector_size(64)));
+KECCAKF_LANES(keccak1600_x8, keccak_v8, 8)
+#pragma GCC pop_options
+
+static int keccak_lanes = 1;
+#endif
+
+const char *keccak_lanes_select(int avx2, int avx512f)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+    keccak_lanes = avx512f ? 8 : avx2 ? 4 : 1;
+    return avx512f ? "avx512" : avx2 ? "avx2" : "generic";
+#else
+    (void)avx2;
+    (void)avx512f;
+    return "generic";
+#endif
+}
+
+void keccak1600_multi(const uint8_t *const *in, const size_t *inlen, uint8_t *const *md, int mdlen, int count)
+{
+    uint8_t st[sizeof(state_t)];
+    int i;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    // a lone message is cheaper on the scalar permutation
+    if (keccak_lanes == 8 && count > 4) {
+        keccak1600_x8(in, inlen, md, mdlen, count);
+        return;
+    }
+    if (keccak_lanes >= 4 && count > 1) {
+        keccak1600_x4(in, inlen, md, mdlen, count);
+        return;
+    }
+#endif
+    for (i = 0; i < count; i++) {
+        keccak1600(in[i], inlen[i], st);
+        memcpy(md[i], st, mdlen);
+    }
+}
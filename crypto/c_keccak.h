@@ -21,6 +21,17 @@ int keccak(const uint8_t *in, int inlen, uint8_t *md, int mdlen);
 // update the state
 void keccakf(uint64_t st[25], int norounds);
 
+// pick the keccakf implementation for this CPU, returns its name
+const char *keccakf_select(int bmi2);
+
 void keccak1600(const uint8_t *in, int inlen, uint8_t *md);
 
+// keccak1600 of count messages of any length, keeping the first mdlen
+// (at most 200) bytes of each state; runs 4 or 8 messages per permutation
+// once keccak_lanes_select has enabled AVX2 or AVX-512
+void keccak1600_multi(const uint8_t *const *in, const size_t *inlen, uint8_t *const *md, int mdlen, int count);
+
+// pick the lane width of keccak1600_multi, returns its name
+const char *keccak_lanes_select(int avx2, int avx512f);
+
 #endif
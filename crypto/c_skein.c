@@ -2026,7 +2026,15 @@ SkeinHashReturn c_skein_hash(int hashbitlen, const BitSequence *data, /* all-in-
                 DataLength databitlen,BitSequence *hashval)
 {
   hashState  state;
-  SkeinHashReturn r = Init(&state,hashbitlen);
+  SkeinHashReturn r;
+
+  if (hashbitlen == 256 && (databitlen & 7) == 0)
+  { /* the common case goes straight to the unrolled Skein-512-256 below */
+    skein512_256(data,(size_t) (databitlen >> 3),hashval);
+    return SKEIN_SUCCESS;
+  }
+
+  r = Init(&state,hashbitlen);
   if (r == SKEIN_SUCCESS)
   { /* these calls do not fail when called properly */
     r = Update(&state,data,databitlen);
@@ -2034,3 +2042,150 @@ SkeinHashReturn c_skein_hash(int hashbitlen, const BitSequence *data, /* all-in-
   }
   return r;
 }
+
+/*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*/
+/* Skein-512-256 of byte-aligned messages, as used by the CryptoNight finalizer.
+** The IV is the precomputed SKEIN_512_IV_256, the tweak of every block follows
+** from the message length alone, and Threefish-512 is written out round by
+** round. SKEIN_512_256_LANES instantiates it for one message (u64b_t) or for
+** several messages with one message per 64-bit vector lane.
+*/
+#define TF512_MIX(X,a,b,ROT)  X[a] += X[b]; X[b] = RotL_64(X[b],ROT); X[b] ^= X[a];
+
+#define TF512_4ROUNDS(X,R)                                              \
+    TF512_MIX(X,0,1,R##_0) TF512_MIX(X,2,3,R##_1) TF512_MIX(X,4,5,R##_2) TF512_MIX(X,6,7,R##_3)
+
+#define TF512_INJECT(X,S)                                               \
+    X[0] += key[((S)+0) % 9];                                            \
+    X[1] += key[((S)+1) % 9];                                            \
+    X[2] += key[((S)+2) % 9];                                            \
+    X[3] += key[((S)+3) % 9];                                            \
+    X[4] += key[((S)+4) % 9];                                            \
+    X[5] += key[((S)+5) % 9] + twk[(S) % 3];                              \
+    X[6] += key[((S)+6) % 9] + twk[((S)+1) % 3];                          \
+    X[7] += key[((S)+7) % 9] + (S);
+
+/* rounds 8*(S-1)/2 .. +7 with the injections S and S+1; the word order
+** of the four MIX pairs follows Round512's permutation */
+#define TF512_8ROUNDS(X,S)                                              \
+    TF512_4ROUNDS(X,R_512_0)                                            \
+    TF512_MIX(X,2,1,R_512_1_0) TF512_MIX(X,4,7,R_512_1_1) TF512_MIX(X,6,5,R_512_1_2) TF512_MIX(X,0,3,R_512_1_3) \
+    TF512_MIX(X,4,1,R_512_2_0) TF512_MIX(X,6,3,R_512_2_1) TF512_MIX(X,0,5,R_512_2_2) TF512_MIX(X,2,7,R_512_2_3) \
+    TF512_MIX(X,6,1,R_512_3_0) TF512_MIX(X,0,7,R_512_3_1) TF512_MIX(X,2,5,R_512_3_2) TF512_MIX(X,4,3,R_512_3_3) \
+    TF512_INJECT(X,S)                                                   \
+    TF512_4ROUNDS(X,R_512_4)                                            \
+    TF512_MIX(X,2,1,R_512_5_0) TF512_MIX(X,4,7,R_512_5_1) TF512_MIX(X,6,5,R_512_5_2) TF512_MIX(X,0,3,R_512_5_3) \
+    TF512_MIX(X,4,1,R_512_6_0) TF512_MIX(X,6,3,R_512_6_1) TF512_MIX(X,0,5,R_512_6_2) TF512_MIX(X,2,7,R_512_6_3) \
+    TF512_MIX(X,6,1,R_512_7_0) TF512_MIX(X,0,7,R_512_7_1) TF512_MIX(X,2,5,R_512_7_2) TF512_MIX(X,4,3,R_512_7_3) \
+    TF512_INJECT(X,(S)+1)
+
+#define SKEIN_512_256_LANES(name, vec, lanes)                           \
+static void name##_block(vec h[8], const vec w[8], u64b_t t0, u64b_t t1) \
+{                                                                       \
+    vec key[9], X[8];                                                    \
+    u64b_t twk[3];                                                       \
+    int i;                                                              \
+                                                                        \
+    twk[0] = t0;                                                         \
+    twk[1] = t1;                                                         \
+    twk[2] = t0 ^ t1;                                                    \
+    key[8] = h[0] ^ SKEIN_KS_PARITY;                                     \
+    for (i = 0; i < 8; i++) {                                           \
+        key[i] = h[i];                                                   \
+        if (i) key[8] ^= h[i];                                           \
+        X[i] = w[i] + key[i];                                            \
+    }                                                                   \
+    X[5] += t0;                                                         \
+    X[6] += t1;                                                         \
+                                                                        \
+    TF512_8ROUNDS(X, 1)  TF512_8ROUNDS(X, 3)  TF512_8ROUNDS(X, 5)       \
+    TF512_8ROUNDS(X, 7)  TF512_8ROUNDS(X, 9)  TF512_8ROUNDS(X,11)       \
+    TF512_8ROUNDS(X,13)  TF512_8ROUNDS(X,15)  TF512_8ROUNDS(X,17)       \
+                                                                        \
+    for (i = 0; i < 8; i++) h[i] = X[i] ^ w[i];                         \
+}                                                                       \
+                                                                        \
+static void name(const u08b_t *const *data, size_t len, u08b_t *const *hashval, int n) \
+{                                                                       \
+    vec h[8], w[8];                                                     \
+    u64b_t b[lanes][8], t1 = SKEIN_T1_FLAG_FIRST | SKEIN_T1_BLK_TYPE_MSG; \
+    size_t pos = 0, cnt;                                                \
+    int i, j;                                                           \
+                                                                        \
+    for (i = 0; i < 8; i++) h[i] = w[i] = (vec){0} + SKEIN_512_IV_256[i]; \
+    do {                                                                \
+        /* the last block, full or not, is the one that carries FINAL */ \
+        cnt = len - pos < SKEIN_512_BLOCK_BYTES ? len - pos : SKEIN_512_BLOCK_BYTES; \
+        for (j = 0; j < lanes; j++) {                                   \
+            const u08b_t *src = data[j < n ? j : n - 1] + pos;          \
+            u08b_t blk[SKEIN_512_BLOCK_BYTES];                          \
+            if (cnt < SKEIN_512_BLOCK_BYTES) {                          \
+                memset(blk, 0, sizeof(blk));                            \
+                memcpy(blk, src, cnt);                                  \
+                src = blk;                                              \
+            }                                                           \
+            Skein_Get64_LSB_First(b[j], src, 8);                        \
+        }                                                               \
+        for (i = 0; i < 8; i++)                                         \
+            for (j = 0; j < lanes; j++) ((u64b_t *) &w[i])[j] = b[j][i]; \
+        pos += cnt;                                                     \
+        name##_block(h, w, pos, t1 | (pos == len ? SKEIN_T1_FLAG_FINAL : 0)); \
+        t1 = SKEIN_T1_BLK_TYPE_MSG;                                     \
+    } while (pos < len);                                                \
+                                                                        \
+    for (i = 0; i < 8; i++) w[i] = (vec){0};                            \
+    name##_block(h, w, sizeof(u64b_t), SKEIN_T1_FLAG_FIRST | SKEIN_T1_BLK_TYPE_OUT_FINAL); \
+    for (j = 0; j < n; j++) {                                           \
+        for (i = 0; i < 4; i++) b[j][i] = ((u64b_t *) &h[i])[j];        \
+        Skein_Put64_LSB_First(hashval[j], b[j], 32);                    \
+    }                                                                   \
+}
+
+SKEIN_512_256_LANES(skein512_256_x1, u64b_t, 1)
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+typedef u64b_t skein_v4 __attribute__((vector_size(32)));
+SKEIN_512_256_LANES(skein512_256_x4, skein_v4, 4)
+#pragma GCC pop_options
+
+static int skein_use_avx2 = 0;
+#endif
+
+const char *skein_select(int avx2)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+  skein_use_avx2 = avx2 != 0;
+  return skein_use_avx2 ? "avx2" : "generic";
+#else
+  (void)avx2;
+  return "generic";
+#endif
+}
+
+void skein512_256(const BitSequence *data, size_t len, BitSequence *hashval)
+{
+  skein512_256_x1(&data, len, &hashval, 1);
+}
+
+void skein512_256_multi(const BitSequence *const *data, size_t len, BitSequence *const *hashval, int count)
+{
+  while (count > 0)
+  {
+    int n = count < 4 ? count : 4;
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (skein_use_avx2 && n > 1)
+      skein512_256_x4(data, len, hashval, n);
+    else
+#endif
+    {
+      int i;
+      for (i = 0; i < n; i++)
+        skein512_256_x1(data + i, len, hashval + i, 1);
+    }
+    data += n;
+    hashval += n;
+    count -= n;
+  }
+}
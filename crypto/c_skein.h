@@ -42,4 +42,13 @@ SkeinHashReturn;
 SkeinHashReturn c_skein_hash(int hashbitlen,   const BitSequence *data,
         DataLength databitlen, BitSequence *hashval);
 
+/* Skein-512-256 of a len-byte message, without the Init/Update/Final state machine */
+void skein512_256(const BitSequence *data, size_t len, BitSequence *hashval);
+
+/* Skein-512-256 of count messages of len bytes each, 4 lanes at a time with AVX2 */
+void skein512_256_multi(const BitSequence *const *data, size_t len, BitSequence *const *hashval, int count);
+
+/* enables the AVX2 lanes of skein512_256_multi; returns the name of the chosen code */
+const char *skein_select(int avx2);
+
 #endif  /* ifndef _SKEIN_H_ */
@@ -0,0 +1,303 @@
+// Groestl permutations with AES-NI. The state is kept as rows (one row of
+// bytes per register): ShiftBytes becomes a pshufb, SubBytes is aesenclast
+// with a zero key (its ShiftRows is undone by the same pshufb) and MixBytes
+// is a fixed combination of rows using GF(2^8) doublings.
+//
+// Groestl-224/256 (P512/Q512, 10 rounds) pack the P row in the low half and
+// the Q row in the high half of each register; Groestl-384/512 (P1024/Q1024,
+// 14 rounds) use one register per row and run P and Q one after the other.
+
+#pragma GCC target("aes,ssse3")
+
+#include <string.h>
+#include <x86intrin.h>
+
+#include "groestl_aesni.h"
+
+int groestl_use_aesni = 0;
+
+const char *groestl_aesni_select(int aesni)
+{
+    groestl_use_aesni = aesni != 0;
+    return groestl_use_aesni ? "aesni" : "generic";
+}
+
+/*
+ * pshufb masks: row i rotated left by its ShiftBytes amount, pre-composed
+ * with the inverse of AES ShiftRows so that aesenclast only adds SubBytes.
+ */
+static const uint8_t shift512[8][16] __attribute__((aligned(16))) = {
+    { 0x00, 0x0e, 0x0b, 0x07, 0x04, 0x01, 0x0f, 0x0c, 0x09, 0x05, 0x02, 0x08, 0x0d, 0x0a, 0x06, 0x03 },
+    { 0x01, 0x08, 0x0d, 0x00, 0x05, 0x02, 0x09, 0x0e, 0x0b, 0x06, 0x03, 0x0a, 0x0f, 0x0c, 0x07, 0x04 },
+    { 0x02, 0x0a, 0x0f, 0x01, 0x06, 0x03, 0x0b, 0x08, 0x0d, 0x07, 0x04, 0x0c, 0x09, 0x0e, 0x00, 0x05 },
+    { 0x03, 0x0c, 0x09, 0x02, 0x07, 0x04, 0x0d, 0x0a, 0x0f, 0x00, 0x05, 0x0e, 0x0b, 0x08, 0x01, 0x06 },
+    { 0x04, 0x0d, 0x0a, 0x03, 0x00, 0x05, 0x0e, 0x0b, 0x08, 0x01, 0x06, 0x0f, 0x0c, 0x09, 0x02, 0x07 },
+    { 0x05, 0x0f, 0x0c, 0x04, 0x01, 0x06, 0x08, 0x0d, 0x0a, 0x02, 0x07, 0x09, 0x0e, 0x0b, 0x03, 0x00 },
+    { 0x06, 0x09, 0x0e, 0x05, 0x02, 0x07, 0x0a, 0x0f, 0x0c, 0x03, 0x00, 0x0b, 0x08, 0x0d, 0x04, 0x01 },
+    { 0x07, 0x0b, 0x08, 0x06, 0x03, 0x00, 0x0c, 0x09, 0x0e, 0x04, 0x01, 0x0d, 0x0a, 0x0f, 0x05, 0x02 }
+};
+
+static const uint8_t shift1024p[8][16] __attribute__((aligned(16))) = {
+    { 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03 },
+    { 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04 },
+    { 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05 },
+    { 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06 },
+    { 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07 },
+    { 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08 },
+    { 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09 },
+    { 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e }
+};
+
+static const uint8_t shift1024q[8][16] __attribute__((aligned(16))) = {
+    { 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04 },
+    { 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06 },
+    { 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08 },
+    { 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e },
+    { 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03 },
+    { 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05 },
+    { 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07 },
+    { 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09 }
+};
+
+/* a * 2 in GF(2^8) with the AES/Groestl polynomial, bytewise */
+static inline __m128i mul2(__m128i a)
+{
+    __m128i carry = _mm_and_si128(_mm_cmpgt_epi8(_mm_setzero_si128(), a), _mm_set1_epi8(0x1b));
+
+    return _mm_xor_si128(_mm_add_epi8(a, a), carry);
+}
+
+/*
+ * MixBytes on rows: b_i = sum_k c_k * a_{i+k} with c = (2,2,3,4,5,3,5,7).
+ * Split c by bits: b = t1 + 2 * (t2 + 2 * t4) where t1, t2, t4 collect the
+ * rows whose coefficient has bit 0, 1 or 2 set.
+ */
+static inline void mix_bytes(__m128i *a)
+{
+    __m128i b[8];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        __m128i a0 = a[i], a1 = a[(i + 1) & 7], a2 = a[(i + 2) & 7], a3 = a[(i + 3) & 7];
+        __m128i a4 = a[(i + 4) & 7], a5 = a[(i + 5) & 7], a6 = a[(i + 6) & 7], a7 = a[(i + 7) & 7];
+        __m128i t567 = _mm_xor_si128(a5, a7);
+        __m128i t1 = _mm_xor_si128(_mm_xor_si128(a2, a4), _mm_xor_si128(a6, t567));
+        __m128i t2 = _mm_xor_si128(_mm_xor_si128(a0, a1), _mm_xor_si128(a2, t567));
+        __m128i t4 = _mm_xor_si128(_mm_xor_si128(a3, a4), _mm_xor_si128(a6, a7));
+
+        b[i] = _mm_xor_si128(t1, mul2(_mm_xor_si128(t2, mul2(t4))));
+    }
+    memcpy(a, b, sizeof(b));
+}
+
+static inline void sub_shift(__m128i *a, const uint8_t (*shift)[16])
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+        a[i] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[i], _mm_load_si128((const __m128i *)shift[i])), _mm_setzero_si128());
+}
+
+/* c<<4 per column, the column part of the round constants */
+static inline __m128i column_constants(void)
+{
+    return _mm_setr_epi8(0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70,
+                         (char)0x80, (char)0x90, (char)0xa0, (char)0xb0, (char)0xc0, (char)0xd0, (char)0xe0, (char)0xf0);
+}
+
+/* P512 on the low halves and Q512 on the high halves of a[0..7] */
+static void perm512_pq(__m128i *a)
+{
+    const __m128i ones = _mm_set1_epi8((char)0xff);
+    const __m128i columns = _mm_unpacklo_epi64(column_constants(), column_constants());
+    const __m128i q_half = _mm_unpackhi_epi64(_mm_setzero_si128(), ones);
+    /* row 0: P gets (c<<4), Q is complemented; row 7: Q gets ~(c<<4) */
+    const __m128i row0 = _mm_or_si128(_mm_andnot_si128(q_half, columns), q_half);
+    const __m128i row7 = _mm_and_si128(q_half, _mm_xor_si128(columns, ones));
+    int i, r;
+
+    for (r = 0; r < 10; r++) {
+        __m128i round = _mm_set1_epi8((char)r);
+
+        a[0] = _mm_xor_si128(a[0], _mm_xor_si128(row0, _mm_andnot_si128(q_half, round)));
+        for (i = 1; i < 7; i++)
+            a[i] = _mm_xor_si128(a[i], q_half);
+        a[7] = _mm_xor_si128(a[7], _mm_xor_si128(row7, _mm_and_si128(q_half, round)));
+
+        sub_shift(a, shift512);
+        mix_bytes(a);
+    }
+}
+
+static void perm1024_p(__m128i *a)
+{
+    const __m128i columns = column_constants();
+    int r;
+
+    for (r = 0; r < 14; r++) {
+        a[0] = _mm_xor_si128(a[0], _mm_xor_si128(columns, _mm_set1_epi8((char)r)));
+        sub_shift(a, shift1024p);
+        mix_bytes(a);
+    }
+}
+
+static void perm1024_q(__m128i *a)
+{
+    const __m128i ones = _mm_set1_epi8((char)0xff);
+    const __m128i row7 = _mm_xor_si128(column_constants(), ones);
+    int i, r;
+
+    for (r = 0; r < 14; r++) {
+        for (i = 0; i < 7; i++)
+            a[i] = _mm_xor_si128(a[i], ones);
+        a[7] = _mm_xor_si128(a[7], _mm_xor_si128(row7, _mm_set1_epi8((char)r)));
+        sub_shift(a, shift1024q);
+        mix_bytes(a);
+    }
+}
+
+/*
+ * 8x8 byte transpose: in[k] holds vectors 2k and 2k+1 (8 bytes each) of a
+ * column-major block, out[k] rows 2k and 2k+1. It is its own inverse.
+ */
+static inline void transpose8(const __m128i *in, __m128i *out)
+{
+    __m128i u01 = _mm_unpacklo_epi8(in[0], _mm_srli_si128(in[0], 8));
+    __m128i u23 = _mm_unpacklo_epi8(in[1], _mm_srli_si128(in[1], 8));
+    __m128i u45 = _mm_unpacklo_epi8(in[2], _mm_srli_si128(in[2], 8));
+    __m128i u67 = _mm_unpacklo_epi8(in[3], _mm_srli_si128(in[3], 8));
+    __m128i v0 = _mm_unpacklo_epi16(u01, u23), v1 = _mm_unpackhi_epi16(u01, u23);
+    __m128i w0 = _mm_unpacklo_epi16(u45, u67), w1 = _mm_unpackhi_epi16(u45, u67);
+
+    out[0] = _mm_unpacklo_epi32(v0, w0);
+    out[1] = _mm_unpackhi_epi32(v0, w0);
+    out[2] = _mm_unpacklo_epi32(v1, w1);
+    out[3] = _mm_unpackhi_epi32(v1, w1);
+}
+
+static inline void load8(const uint8_t *p, __m128i *x)
+{
+    x[0] = _mm_loadu_si128((const __m128i *)p);
+    x[1] = _mm_loadu_si128((const __m128i *)(p + 16));
+    x[2] = _mm_loadu_si128((const __m128i *)(p + 32));
+    x[3] = _mm_loadu_si128((const __m128i *)(p + 48));
+}
+
+static inline void store8(uint8_t *p, const __m128i *x)
+{
+    _mm_storeu_si128((__m128i *)p, x[0]);
+    _mm_storeu_si128((__m128i *)(p + 16), x[1]);
+    _mm_storeu_si128((__m128i *)(p + 32), x[2]);
+    _mm_storeu_si128((__m128i *)(p + 48), x[3]);
+}
+
+/* Column-major 128-byte state to 8 rows of 16 bytes, and back. */
+static inline void to_rows1024(const uint8_t *p, __m128i *rows)
+{
+    __m128i x[4], lo[4], hi[4];
+    int k;
+
+    load8(p, x);
+    transpose8(x, lo);
+    load8(p + 64, x);
+    transpose8(x, hi);
+    for (k = 0; k < 4; k++) {
+        rows[2 * k] = _mm_unpacklo_epi64(lo[k], hi[k]);
+        rows[2 * k + 1] = _mm_unpackhi_epi64(lo[k], hi[k]);
+    }
+}
+
+static inline void from_rows1024(const __m128i *rows, uint8_t *p)
+{
+    __m128i x[4], y[4];
+    int k;
+
+    for (k = 0; k < 4; k++)
+        x[k] = _mm_unpacklo_epi64(rows[2 * k], rows[2 * k + 1]);
+    transpose8(x, y);
+    store8(p, y);
+    for (k = 0; k < 4; k++)
+        x[k] = _mm_unpackhi_epi64(rows[2 * k], rows[2 * k + 1]);
+    transpose8(x, y);
+    store8(p + 64, y);
+}
+
+void groestl512_compress_aesni(uint8_t *h, const uint8_t *m)
+{
+    __m128i x[4], hr[4], mr[4], a[8], out[4];
+    int k;
+
+    load8(h, x);
+    transpose8(x, hr);
+    load8(m, x);
+    transpose8(x, mr);
+
+    /* P(h ^ m) in the low halves, Q(m) in the high halves */
+    for (k = 0; k < 4; k++) {
+        __m128i p = _mm_xor_si128(hr[k], mr[k]);
+        a[2 * k] = _mm_unpacklo_epi64(p, mr[k]);
+        a[2 * k + 1] = _mm_unpackhi_epi64(p, mr[k]);
+    }
+    perm512_pq(a);
+
+    /* h ^= P ^ Q, back in row pairs */
+    for (k = 0; k < 4; k++) {
+        __m128i pq0 = _mm_xor_si128(a[2 * k], _mm_srli_si128(a[2 * k], 8));
+        __m128i pq1 = _mm_xor_si128(a[2 * k + 1], _mm_srli_si128(a[2 * k + 1], 8));
+        x[k] = _mm_xor_si128(hr[k], _mm_unpacklo_epi64(pq0, pq1));
+    }
+    transpose8(x, out);
+    store8(h, out);
+}
+
+void groestl512_output_aesni(uint8_t *h)
+{
+    __m128i x[4], hr[4], a[8], out[4];
+    int k;
+
+    load8(h, x);
+    transpose8(x, hr);
+
+    /* only P is needed; the Q halves just ride along */
+    for (k = 0; k < 4; k++) {
+        a[2 * k] = _mm_unpacklo_epi64(hr[k], hr[k]);
+        a[2 * k + 1] = _mm_unpackhi_epi64(hr[k], hr[k]);
+    }
+    perm512_pq(a);
+
+    for (k = 0; k < 4; k++)
+        x[k] = _mm_xor_si128(hr[k], _mm_unpacklo_epi64(a[2 * k], a[2 * k + 1]));
+    transpose8(x, out);
+    store8(h, out);
+}
+
+void groestl1024_compress_aesni(uint8_t *h, const uint8_t *m)
+{
+    __m128i hr[8], p[8], q[8];
+    int i;
+
+    to_rows1024(h, hr);
+    to_rows1024(m, q);
+    for (i = 0; i < 8; i++)
+        p[i] = _mm_xor_si128(hr[i], q[i]);
+
+    perm1024_p(p);
+    perm1024_q(q);
+
+    for (i = 0; i < 8; i++)
+        hr[i] = _mm_xor_si128(hr[i], _mm_xor_si128(p[i], q[i]));
+    from_rows1024(hr, h);
+}
+
+void groestl1024_output_aesni(uint8_t *h)
+{
+    __m128i hr[8], p[8];
+    int i;
+
+    to_rows1024(h, hr);
+    memcpy(p, hr, sizeof(p));
+    perm1024_p(p);
+    for (i = 0; i < 8; i++)
+        hr[i] = _mm_xor_si128(hr[i], p[i]);
+    from_rows1024(hr, h);
+}
@@ -0,0 +1,32 @@
+// groestl_aesni.h
+// AES-NI Groestl compression functions shared by c_groestl.c and sph_groestl.c
+
+#ifndef GROESTL_AESNI_H
+#define GROESTL_AESNI_H
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// set by groestl_aesni_select, read by both Groestl implementations
+extern int groestl_use_aesni;
+
+// turns the AES-NI path on for CPUs with AES-NI and SSSE3, returns its name
+const char *groestl_aesni_select(int aesni);
+
+// h = P(h ^ m) ^ Q(m) ^ h on a column-major 64-byte state (Groestl-224/256)
+void groestl512_compress_aesni(uint8_t *h, const uint8_t *m);
+// h = P(h) ^ h, the output transformation
+void groestl512_output_aesni(uint8_t *h);
+
+// the same for the 128-byte state of Groestl-384/512
+void groestl1024_compress_aesni(uint8_t *h, const uint8_t *m);
+void groestl1024_output_aesni(uint8_t *h);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -47,6 +47,7 @@ enum {
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
+void cn_fast_hash_multi(const void *const *data, const size_t *length, char *const *hash, size_t count);
 void cn_slow_hash(const void *data, size_t length, char *hash);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
@@ -55,3 +56,5 @@ void hash_extra_jh(const void *data, size_t length, char *hash);
 void hash_extra_skein(const void *data, size_t length, char *hash);
 
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
+size_t tree_branch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[HASH_SIZE]);
+void tree_hash_from_branch(const char (*branch)[HASH_SIZE], size_t depth, const char *leaf, char *root_hash);
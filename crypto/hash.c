@@ -22,3 +22,7 @@ void cn_fast_hash(const void *data, size_t length, char *hash) {
   hash_process(&state, data, length);
   memcpy(hash, &state, HASH_SIZE);
 }
+
+void cn_fast_hash_multi(const void *const *data, const size_t *length, char *const *hash, size_t count) {
+  keccak1600_multi((const uint8_t *const *) data, length, (uint8_t *const *) hash, HASH_SIZE, count);
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash-ops.h"
+
+// Most pairs hashed per cn_fast_hash_multi call
+#define TREE_HASH_BATCH 64
+
+// Largest power of two below count (count >= 3)
+static size_t tree_hash_cnt(size_t count) {
+  size_t pow = 2;
+
+  assert(count >= 3);
+  while (pow < count) {
+    pow <<= 1;
+  }
+  return pow >> 1;
+}
+
+// Hashes the pairs hashes[2 * j], hashes[2 * j + 1] into out[j], j < pairs,
+// several pairs per Keccak permutation. out may be hashes itself: a chunk
+// starting at pair i is never longer than i, so it only overwrites hashes
+// that earlier chunks have consumed.
+static void tree_hash_level(const char (*hashes)[HASH_SIZE], size_t pairs, char (*out)[HASH_SIZE]) {
+  const void *in[TREE_HASH_BATCH];
+  size_t length[TREE_HASH_BATCH];
+  char *hash[TREE_HASH_BATCH];
+  size_t i, j, n;
+
+  for (i = 0; i < pairs; i += n) {
+    n = i == 0 ? 1 : i < TREE_HASH_BATCH ? i : TREE_HASH_BATCH;
+    if (n > pairs - i) {
+      n = pairs - i;
+    }
+    for (j = 0; j < n; j++) {
+      in[j] = hashes[2 * (i + j)];
+      length[j] = 2 * HASH_SIZE;
+      hash[j] = out[i + j];
+    }
+    cn_fast_hash_multi(in, length, hash, n);
+  }
+}
+
+void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
+  assert(count > 0);
+  if (count == 1) {
+    memcpy(root_hash, hashes, HASH_SIZE);
+  } else if (count == 2) {
+    cn_fast_hash(hashes, 2 * HASH_SIZE, root_hash);
+  } else {
+    size_t cnt = tree_hash_cnt(count);
+    size_t keep = 2 * cnt - count;
+    char (*ints)[HASH_SIZE] = malloc(cnt * HASH_SIZE);
+
+    // the first 2 * cnt - count hashes move up as they are, the rest are paired
+    memcpy(ints, hashes, keep * HASH_SIZE);
+    tree_hash_level(hashes + keep, cnt - keep, ints + keep);
+    while (cnt > 2) {
+      cnt >>= 1;
+      tree_hash_level((const char (*)[HASH_SIZE]) ints, cnt, ints);
+    }
+    cn_fast_hash(ints, 2 * HASH_SIZE, root_hash);
+    free(ints);
+  }
+}
+
+// The sibling path of leaf 0, bottom level first: with it the root for any
+// leaf 0 takes one hash per level. Returns the depth, the number of hashes
+// written to branch (at most 8 * sizeof(size_t)).
+size_t tree_branch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[HASH_SIZE]) {
+  size_t depth = 0;
+
+  assert(count > 0);
+  if (count == 1) {
+    return 0;
+  } else if (count == 2) {
+    memcpy(branch[depth++], hashes[1], HASH_SIZE);
+  } else {
+    size_t cnt = tree_hash_cnt(count);
+    size_t keep = 2 * cnt - count;
+    char (*ints)[HASH_SIZE] = malloc(cnt * HASH_SIZE);
+
+    // ints[0], the node above leaf 0, is never computed
+    if (keep == 0) {
+      memcpy(branch[depth++], hashes[1], HASH_SIZE);
+      tree_hash_level(hashes + 2, cnt - 1, ints + 1);
+    } else {
+      memcpy(ints + 1, hashes + 1, (keep - 1) * HASH_SIZE);
+      tree_hash_level(hashes + keep, cnt - keep, ints + keep);
+    }
+    while (cnt > 1) {
+      memcpy(branch[depth++], ints[1], HASH_SIZE);
+      cnt >>= 1;
+      if (cnt > 1) {
+        tree_hash_level((const char (*)[HASH_SIZE]) ints + 2, cnt - 1, ints + 1);
+      }
+    }
+    free(ints);
+  }
+  return depth;
+}
+
+// The root of the tree tree_branch came from, with leaf 0 replaced by leaf
+void tree_hash_from_branch(const char (*branch)[HASH_SIZE], size_t depth, const char *leaf, char *root_hash) {
+  char buffer[2][HASH_SIZE];
+  size_t i;
+
+  memcpy(root_hash, leaf, HASH_SIZE);
+  for (i = 0; i < depth; i++) {
+    memcpy(buffer[0], root_hash, HASH_SIZE);
+    memcpy(buffer[1], branch[i], HASH_SIZE);
+    cn_fast_hash(buffer, 2 * HASH_SIZE, root_hash);
+  }
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Runtime dispatch to the CryptoNight backend matching the host CPU. The
+// backends themselves live in cryptonight_{soft,aesni,avx2,avx512}.cc.
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+    #include "crypto/hash-ops.h"
+    #include "cryptonight.h"
+    #include "cryptonight_light.h"
+    #include "cryptonight_heavy.h"
+    #include "cryptonight_backend.h"
+    #include "cpu_features.h"
+}
+
+static const struct cn_backend *cn_active = &cn_backend_soft;
+
+const char* cryptonight_select(int level, int vaes)
+{
+    if (level >= CPU_LEVEL_AVX512 && vaes)
+        cn_active = &cn_backend_avx512;
+    else if (level >= CPU_LEVEL_AVX2)
+        cn_active = &cn_backend_avx2;
+    else if (level >= CPU_LEVEL_AESNI)
+        cn_active = &cn_backend_aesni;
+    else
+        cn_active = &cn_backend_soft;
+    return cn_active->name;
+}
+
+const char* cryptonight_backend(void)
+{
+    return cn_active->name;
+}
+
+void cryptonight_hash(const char* input, char* output, uint32_t len) {
+    cn_active->original.hash(input, output, len);
+}
+
+void cryptonight_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways) {
+    cn_active->original.hash_multi(inputs, outputs, lens, ways);
+}
+
+void cryptonight_fast_hash(const char* input, char* output, uint32_t len) {
+    cn_fast_hash(input, len, output);
+}
+
+void cryptonight_fast_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t count) {
+    size_t length[CN_FAST_BATCH];
+
+    for (uint32_t start = 0; start < count; start += CN_FAST_BATCH) {
+        uint32_t n = count - start < CN_FAST_BATCH ? count - start : CN_FAST_BATCH;
+
+        for (uint32_t i = 0; i < n; i++)
+            length[i] = lens[start + i];
+        cn_fast_hash_multi((const void* const*)(inputs + start), length, outputs + start, n);
+    }
+}
+
+void cryptonight_light_hash(const char* input, char* output, uint32_t len) {
+    cn_active->light.hash(input, output, len);
+}
+
+void cryptonight_light_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways) {
+    cn_active->light.hash_multi(inputs, outputs, lens, ways);
+}
+
+void cryptonight_light_fast_hash(const char* input, char* output, uint32_t len) {
+    cn_fast_hash(input, len, output);
+}
+
+void cryptonight_heavy_hash(const char* input, char* output, uint32_t len) {
+    cn_active->heavy.hash(input, output, len);
+}
+
+void cryptonight_heavy_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways) {
+    cn_active->heavy.hash_multi(inputs, outputs, lens, ways);
+}
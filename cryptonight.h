@@ -7,8 +7,16 @@ extern "C" {
 
 #include <stdint.h>
 
+/* Maximum number of hashes cryptonight_hash_multi() interleaves per thread. */
+#define CN_MAX_WAYS 5
+
+/* Messages a batch thread takes at a time for cryptonight_fast_hash_multi(). */
+#define CN_FAST_BATCH 64
+
 void cryptonight_hash(const char* input, char* output, uint32_t len);
+void cryptonight_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways);
 void cryptonight_fast_hash(const char* input, char* output, uint32_t len);
+void cryptonight_fast_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t count);
 
 #ifdef __cplusplus
 }
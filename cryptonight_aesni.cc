@@ -0,0 +1,12 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// CryptoNight backend: AES-NI + SSE4.1, 128-bit explode/implode
+
+#pragma GCC target("aes,sse4.1")
+
+#define CN_VAES_WIDTH 0
+#include "cryptonight_core.h"
+
+CN_DEFINE_BACKEND(cn_backend_aesni, "aesni")
@@ -0,0 +1,12 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// CryptoNight backend: AVX2 + BMI2; VAES-256 explode/implode when the CPU has it
+
+#pragma GCC target("aes,sse4.1,avx2,bmi,bmi2")
+
+#define CN_VAES_WIDTH 256
+#include "cryptonight_core.h"
+
+CN_DEFINE_BACKEND(cn_backend_avx2, "avx2")
@@ -0,0 +1,44 @@
+#ifndef CRYPTONIGHT_BACKEND_H
+#define CRYPTONIGHT_BACKEND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef void (*cn_hash_fn)(const char* input, char* output, uint32_t len);
+typedef void (*cn_hash_multi_fn)(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways);
+
+struct cn_variant_backend {
+    cn_hash_fn hash;
+    cn_hash_multi_fn hash_multi;
+};
+
+/* The CryptoNight core compiled for one ISA level (cryptonight_<level>.cc) */
+struct cn_backend {
+    const char* name;
+    struct cn_variant_backend original;
+    struct cn_variant_backend light;
+    struct cn_variant_backend heavy;
+};
+
+extern const struct cn_backend cn_backend_soft;
+extern const struct cn_backend cn_backend_aesni;
+extern const struct cn_backend cn_backend_avx2;
+extern const struct cn_backend cn_backend_avx512;
+
+/*
+ * Routes cryptonight_*_hash to the best backend for `level` (enum cpu_level)
+ * and returns its name. Below CPU_LEVEL_AESNI that is the software backend.
+ */
+const char* cryptonight_select(int level, int vaes);
+
+/* Name of the selected backend. */
+const char* cryptonight_backend(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,848 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// CryptoNight core shared by every variant. A variant only fixes the
+// scratchpad size, the iteration count and whether the heavy tweaks apply;
+// masks and loop bounds are derived from those at compile time.
+//
+// Each cryptonight_<level>.cc sets the target ISA with #pragma GCC target,
+// defines CN_VAES_WIDTH and includes this header once to build a backend.
+// With CN_SOFT_AES defined the AES rounds and key schedule use the aesb.c
+// tables and only SSE2 is needed.
+
+#ifndef CRYPTONIGHT_CORE_H
+#define CRYPTONIGHT_CORE_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+extern "C" {
+    #include "crypto/hash-ops.h"
+}
+// c_groestl.h and friends pull in hash.h, whose C++ part must stay outside extern "C"
+#include "crypto/hash.h"
+
+extern "C" {
+    #include "crypto/c_keccak.h"
+    #include "crypto/c_groestl.h"
+    #include "crypto/c_blake256.h"
+    #include "crypto/c_jh.h"
+    #include "crypto/c_skein.h"
+    #include "crypto/aesb.h"
+    #include "cryptonight.h"
+    #include "cryptonight_backend.h"
+    #include "cryptonight_scratchpad.h"
+    #include "cryptonight_stats.h"
+    #include "cpu_features.h"
+}
+
+#ifndef CN_VAES_WIDTH
+#define CN_VAES_WIDTH 0
+#endif
+
+#define AES_BLOCK_SIZE  16
+#define AES_KEY_SIZE    32 /*16*/
+#define INIT_SIZE_BLK   8
+#define INIT_SIZE_BYTE (INIT_SIZE_BLK * AES_BLOCK_SIZE)
+
+template<size_t MEMORY_, size_t ITER_, bool HEAVY_>
+struct cn_variant
+{
+    static const size_t MEMORY = MEMORY_;
+    static const size_t ITER = ITER_;
+    static const bool HEAVY = HEAVY_;
+
+    // Byte offset mask of a 16-byte aligned block inside the scratchpad
+    static const size_t MASK = MEMORY - AES_BLOCK_SIZE;
+    // 128-byte blocks written by the explode phase / read by the implode phase
+    static const size_t INIT_ROUNDS = MEMORY / INIT_SIZE_BYTE;
+    // Every main loop iteration performs two of the ITER half-steps
+    static const size_t MAIN_ROUNDS = ITER / 2;
+};
+
+typedef cn_variant<1 << 21, 1 << 20, false> cn_original; /* 2 MiB */
+typedef cn_variant<1 << 20, 1 << 19, false> cn_light;    /* 1 MiB */
+typedef cn_variant<1 << 22, 1 << 19, true> cn_heavy;     /* 4 MiB */
+
+#pragma pack(push, 1)
+union cn_slow_hash_state {
+    uint8_t b[200];
+    uint64_t w[25];
+    struct {
+        uint8_t k[64];
+        uint8_t init[INIT_SIZE_BYTE];
+    };
+};
+#pragma pack(pop)
+
+static void do_blake_hash(const void* input, size_t len, char* output) {
+    blake256_hash((uint8_t*)output, (const uint8_t*)input, len);
+}
+
+static void do_groestl_hash(const void* input, size_t len, char* output) {
+    groestl((const BitSequence*)input, len * 8, (uint8_t*)output);
+}
+
+static void do_jh_hash(const void* input, size_t len, char* output) {
+    int r = jh_hash(HASH_SIZE * 8, (const BitSequence*)input, 8 * len, (uint8_t*)output);
+    assert(SUCCESS == r);
+    (void)r;
+}
+
+static void do_skein_hash(const void* input, size_t len, char* output) {
+    skein512_256((const BitSequence*)input, len, (uint8_t*)output);
+}
+
+static void (* const extra_hashes[4])(const void *, size_t, char *) = {
+    do_blake_hash, do_groestl_hash, do_jh_hash, do_skein_hash
+};
+
+// The same finalizers for several 200-byte states at once, used by multi-way hashes
+static void do_blake_multi(const uint8_t* const* input, uint8_t* const* output, int count) {
+    blake256_hash_multi(output, input, 200, count);
+}
+
+static void do_groestl_multi(const uint8_t* const* input, uint8_t* const* output, int count) {
+    for (int i = 0; i < count; i++)
+        groestl(input[i], 200 * 8, output[i]);
+}
+
+static void do_jh_multi(const uint8_t* const* input, uint8_t* const* output, int count) {
+    jh256_hash_multi(input, 200, output, count);
+}
+
+static void do_skein_multi(const uint8_t* const* input, uint8_t* const* output, int count) {
+    skein512_256_multi(input, 200, output, count);
+}
+
+static void (* const extra_hashes_multi[4])(const uint8_t* const*, uint8_t* const*, int) = {
+    do_blake_multi, do_groestl_multi, do_jh_multi, do_skein_multi
+};
+
+#ifdef CN_SOFT_AES
+// aesenc from the aesb.c round tables; column c takes row r from column c + r
+static inline __attribute__((always_inline)) __m128i cn_aesenc(__m128i x, __m128i key)
+{
+    uint32_t s[4] __attribute((aligned(16)));
+    uint32_t r0, r1, r2, r3;
+
+    _mm_store_si128((__m128i *)s, x);
+
+    r0 = t_fn[0][s[0] & 0xff] ^ t_fn[1][(s[1] >> 8) & 0xff] ^ t_fn[2][(s[2] >> 16) & 0xff] ^ t_fn[3][s[3] >> 24];
+    r1 = t_fn[0][s[1] & 0xff] ^ t_fn[1][(s[2] >> 8) & 0xff] ^ t_fn[2][(s[3] >> 16) & 0xff] ^ t_fn[3][s[0] >> 24];
+    r2 = t_fn[0][s[2] & 0xff] ^ t_fn[1][(s[3] >> 8) & 0xff] ^ t_fn[2][(s[0] >> 16) & 0xff] ^ t_fn[3][s[1] >> 24];
+    r3 = t_fn[0][s[3] & 0xff] ^ t_fn[1][(s[0] >> 8) & 0xff] ^ t_fn[2][(s[1] >> 16) & 0xff] ^ t_fn[3][s[2] >> 24];
+
+    return _mm_xor_si128(_mm_set_epi32(r3, r2, r1, r0), key);
+}
+
+// SubBytes of one little-endian word; byte 1 of t_fn[0][x] is sbox[x]
+static inline uint32_t cn_soft_subword(uint32_t w)
+{
+    return ((t_fn[0][w & 0xff] >> 8) & 0xff) |
+        (t_fn[0][(w >> 8) & 0xff] & 0xff00) |
+        ((t_fn[0][(w >> 16) & 0xff] << 8) & 0xff0000) |
+        ((t_fn[0][w >> 24] << 16) & 0xff000000);
+}
+
+// Plain FIPS-197 AES-256 schedule, same 15 round keys as the AES-NI version
+static inline void ExpandAESKey256(uint8_t *keybuf)
+{
+    static const uint32_t rcon[7] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40 };
+    uint32_t *w = (uint32_t *)keybuf;
+
+    for (int i = 8; i < 60; i++)
+    {
+        uint32_t t = w[i - 1];
+
+        if ((i & 7) == 0)
+            t = cn_soft_subword((t >> 8) | (t << 24)) ^ rcon[(i >> 3) - 1];
+        else if ((i & 7) == 4)
+            t = cn_soft_subword(t);
+        w[i] = w[i - 8] ^ t;
+    }
+}
+#else
+static inline __attribute__((always_inline)) __m128i cn_aesenc(__m128i x, __m128i key)
+{
+    return _mm_aesenc_si128(x, key);
+}
+
+static inline void ExpandAESKey256_sub1(__m128i *tmp1, __m128i *tmp2)
+{
+    __m128i tmp4;
+    *tmp2 = _mm_shuffle_epi32(*tmp2, 0xFF);
+    tmp4 = _mm_slli_si128(*tmp1, 0x04);
+    *tmp1 = _mm_xor_si128(*tmp1, tmp4);
+    tmp4 = _mm_slli_si128(tmp4, 0x04);
+    *tmp1 = _mm_xor_si128(*tmp1, tmp4);
+    tmp4 = _mm_slli_si128(tmp4, 0x04);
+    *tmp1 = _mm_xor_si128(*tmp1, tmp4);
+    *tmp1 = _mm_xor_si128(*tmp1, *tmp2);
+}
+
+static inline void ExpandAESKey256_sub2(__m128i *tmp1, __m128i *tmp3)
+{
+    __m128i tmp2, tmp4;
+
+    tmp4 = _mm_aeskeygenassist_si128(*tmp1, 0x00);
+    tmp2 = _mm_shuffle_epi32(tmp4, 0xAA);
+    tmp4 = _mm_slli_si128(*tmp3, 0x04);
+    *tmp3 = _mm_xor_si128(*tmp3, tmp4);
+    tmp4 = _mm_slli_si128(tmp4, 0x04);
+    *tmp3 = _mm_xor_si128(*tmp3, tmp4);
+    tmp4 = _mm_slli_si128(tmp4, 0x04);
+    *tmp3 = _mm_xor_si128(*tmp3, tmp4);
+    *tmp3 = _mm_xor_si128(*tmp3, tmp2);
+}
+
+// Special thanks to Intel for helping me
+// with ExpandAESKey256() and its subroutines
+static inline void ExpandAESKey256(uint8_t *keybuf)
+{
+    __m128i tmp1, tmp2, tmp3, *keys;
+
+    keys = (__m128i *)keybuf;
+
+    tmp1 = _mm_load_si128((__m128i *)keybuf);
+    tmp3 = _mm_load_si128((__m128i *)(keybuf+0x10));
+
+    tmp2 = _mm_aeskeygenassist_si128(tmp3, 0x01);
+    ExpandAESKey256_sub1(&tmp1, &tmp2);
+    keys[2] = tmp1;
+    ExpandAESKey256_sub2(&tmp1, &tmp3);
+    keys[3] = tmp3;
+
+    tmp2 = _mm_aeskeygenassist_si128(tmp3, 0x02);
+    ExpandAESKey256_sub1(&tmp1, &tmp2);
+    keys[4] = tmp1;
+    ExpandAESKey256_sub2(&tmp1, &tmp3);
+    keys[5] = tmp3;
+
+    tmp2 = _mm_aeskeygenassist_si128(tmp3, 0x04);
+    ExpandAESKey256_sub1(&tmp1, &tmp2);
+    keys[6] = tmp1;
+    ExpandAESKey256_sub2(&tmp1, &tmp3);
+    keys[7] = tmp3;
+
+    tmp2 = _mm_aeskeygenassist_si128(tmp3, 0x08);
+    ExpandAESKey256_sub1(&tmp1, &tmp2);
+    keys[8] = tmp1;
+    ExpandAESKey256_sub2(&tmp1, &tmp3);
+    keys[9] = tmp3;
+
+    tmp2 = _mm_aeskeygenassist_si128(tmp3, 0x10);
+    ExpandAESKey256_sub1(&tmp1, &tmp2);
+    keys[10] = tmp1;
+    ExpandAESKey256_sub2(&tmp1, &tmp3);
+    keys[11] = tmp3;
+
+    tmp2 = _mm_aeskeygenassist_si128(tmp3, 0x20);
+    ExpandAESKey256_sub1(&tmp1, &tmp2);
+    keys[12] = tmp1;
+    ExpandAESKey256_sub2(&tmp1, &tmp3);
+    keys[13] = tmp3;
+
+    tmp2 = _mm_aeskeygenassist_si128(tmp3, 0x40);
+    ExpandAESKey256_sub1(&tmp1, &tmp2);
+    keys[14] = tmp1;
+}
+#endif
+
+static const uint64_t cn_keccakf_rndc[24] =
+{
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+    0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+    0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+    0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+    0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+static const uint32_t cn_keccakf_rotc[24] =
+{
+    1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14,
+    27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
+};
+
+static const uint32_t cn_keccakf_piln[24] =
+{
+    10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4,
+    15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1
+};
+
+#define bitselect(a, b, c)  ((a) ^ ((c) & ((b) ^ (a))))
+
+static void CNKeccakF1600(uint64_t *st)
+{
+    int i, round;
+    uint64_t t, bc[5];
+
+    for(round = 0; round < 24; ++round)
+    {
+        bc[0] = st[0] ^ st[5] ^ st[10] ^ st[15] ^ st[20] ^ ROTL64(st[2] ^ st[7] ^ st[12] ^ st[17] ^ st[22], 1UL);
+        bc[1] = st[1] ^ st[6] ^ st[11] ^ st[16] ^ st[21] ^ ROTL64(st[3] ^ st[8] ^ st[13] ^ st[18] ^ st[23], 1UL);
+        bc[2] = st[2] ^ st[7] ^ st[12] ^ st[17] ^ st[22] ^ ROTL64(st[4] ^ st[9] ^ st[14] ^ st[19] ^ st[24], 1UL);
+        bc[3] = st[3] ^ st[8] ^ st[13] ^ st[18] ^ st[23] ^ ROTL64(st[0] ^ st[5] ^ st[10] ^ st[15] ^ st[20], 1UL);
+        bc[4] = st[4] ^ st[9] ^ st[14] ^ st[19] ^ st[24] ^ ROTL64(st[1] ^ st[6] ^ st[11] ^ st[16] ^ st[21], 1UL);
+
+        for(i = 0; i < 25; i += 5)
+        {
+            st[i] ^= bc[4];
+            st[i + 1] ^= bc[0];
+            st[i + 2] ^= bc[1];
+            st[i + 3] ^= bc[2];
+            st[i + 4] ^= bc[3];
+        }
+
+        // Rho Pi
+        t = st[1];
+        for (i = 0; i < 24; ++i) {
+            bc[0] = st[cn_keccakf_piln[i]];
+            st[cn_keccakf_piln[i]] = ROTL64(t, cn_keccakf_rotc[i]);
+            t = bc[0];
+        }
+
+        for(i = 0; i < 25; i += 5)
+        {
+            uint64_t tmp1 = st[i], tmp2 = st[i + 1];
+
+            st[i] = bitselect(st[i] ^ st[i + 2], st[i], st[i + 1]);
+            st[i + 1] = bitselect(st[i + 1] ^ st[i + 3], st[i + 1], st[i + 2]);
+            st[i + 2] = bitselect(st[i + 2] ^ st[i + 4], st[i + 2], st[i + 3]);
+            st[i + 3] = bitselect(st[i + 3] ^ tmp1, st[i + 3], st[i + 4]);
+            st[i + 4] = bitselect(st[i + 4] ^ tmp2, st[i + 4], tmp1);
+        }
+
+        //  Iota
+        st[0] ^= cn_keccakf_rndc[round];
+    }
+}
+
+// Absorbs the input into a full 200-byte Keccak state. 76-byte block hashing
+// blobs fit in a single rate block and take the unrolled path.
+static void CNKeccak(uint64_t *output, const char *input, uint32_t len)
+{
+    uint64_t st[25];
+
+    if (len != 76) {
+        keccak1600((const uint8_t *)input, len, (uint8_t *)output);
+        return;
+    }
+
+    // Copy 72 bytes
+    memcpy(st, input, 72);
+
+    st[9] = (uint64_t)*(const uint32_t *)(input + 72) | 0x0000000100000000UL;
+
+    for(int i = 10; i < 25; ++i) st[i] = 0x00UL;
+
+    // Last bit of padding
+    st[16] = 0x8000000000000000UL;
+
+    CNKeccakF1600(st);
+
+    memcpy(output, st, 200);
+}
+
+// cn-heavy: fold every block into its neighbour between AES passes
+static inline __attribute__((always_inline)) void cn_mix_and_propagate(__m128i *x)
+{
+    __m128i tmp0 = x[0];
+    x[0] = _mm_xor_si128(x[0], x[1]);
+    x[1] = _mm_xor_si128(x[1], x[2]);
+    x[2] = _mm_xor_si128(x[2], x[3]);
+    x[3] = _mm_xor_si128(x[3], x[4]);
+    x[4] = _mm_xor_si128(x[4], x[5]);
+    x[5] = _mm_xor_si128(x[5], x[6]);
+    x[6] = _mm_xor_si128(x[6], x[7]);
+    x[7] = _mm_xor_si128(x[7], tmp0);
+}
+
+static inline __attribute__((always_inline)) void cn_aes_10_rounds(const __m128i *expkey, __m128i *x)
+{
+    for(int j = 0; j < 10; j++)
+    {
+        x[0] = cn_aesenc(x[0], expkey[j]);
+        x[1] = cn_aesenc(x[1], expkey[j]);
+        x[2] = cn_aesenc(x[2], expkey[j]);
+        x[3] = cn_aesenc(x[3], expkey[j]);
+        x[4] = cn_aesenc(x[4], expkey[j]);
+        x[5] = cn_aesenc(x[5], expkey[j]);
+        x[6] = cn_aesenc(x[6], expkey[j]);
+        x[7] = cn_aesenc(x[7], expkey[j]);
+    }
+}
+
+template<class V>
+static inline __attribute__((always_inline)) void cn_explode_scratchpad(const __m128i *expkey, __m128i *xmminput, __m128i *longoutput)
+{
+    if (V::HEAVY)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            cn_aes_10_rounds(expkey, xmminput);
+            cn_mix_and_propagate(xmminput);
+        }
+    }
+
+    for (size_t i = 0; __builtin_expect(i < V::INIT_ROUNDS, 1); ++i)
+    {
+        cn_aes_10_rounds(expkey, xmminput);
+
+        _mm_store_si128(&(longoutput[(i << 3)]), xmminput[0]);
+        _mm_store_si128(&(longoutput[(i << 3) + 1]), xmminput[1]);
+        _mm_store_si128(&(longoutput[(i << 3) + 2]), xmminput[2]);
+        _mm_store_si128(&(longoutput[(i << 3) + 3]), xmminput[3]);
+        _mm_store_si128(&(longoutput[(i << 3) + 4]), xmminput[4]);
+        _mm_store_si128(&(longoutput[(i << 3) + 5]), xmminput[5]);
+        _mm_store_si128(&(longoutput[(i << 3) + 6]), xmminput[6]);
+        _mm_store_si128(&(longoutput[(i << 3) + 7]), xmminput[7]);
+    }
+}
+
+template<class V>
+static inline __attribute__((always_inline)) void cn_implode_pass(const __m128i *expkey, __m128i *xmminput, const __m128i *longoutput)
+{
+    for (size_t i = 0; __builtin_expect(i < V::INIT_ROUNDS, 1); ++i)
+    {
+        xmminput[0] = _mm_xor_si128(longoutput[(i << 3)], xmminput[0]);
+        xmminput[1] = _mm_xor_si128(longoutput[(i << 3) + 1], xmminput[1]);
+        xmminput[2] = _mm_xor_si128(longoutput[(i << 3) + 2], xmminput[2]);
+        xmminput[3] = _mm_xor_si128(longoutput[(i << 3) + 3], xmminput[3]);
+        xmminput[4] = _mm_xor_si128(longoutput[(i << 3) + 4], xmminput[4]);
+        xmminput[5] = _mm_xor_si128(longoutput[(i << 3) + 5], xmminput[5]);
+        xmminput[6] = _mm_xor_si128(longoutput[(i << 3) + 6], xmminput[6]);
+        xmminput[7] = _mm_xor_si128(longoutput[(i << 3) + 7], xmminput[7]);
+
+        cn_aes_10_rounds(expkey, xmminput);
+
+        if (V::HEAVY)
+            cn_mix_and_propagate(xmminput);
+    }
+}
+
+template<class V>
+static inline __attribute__((always_inline)) void cn_implode_scratchpad(const __m128i *expkey, __m128i *xmminput, const __m128i *longoutput)
+{
+    cn_implode_pass<V>(expkey, xmminput, longoutput);
+
+    if (V::HEAVY)
+    {
+        cn_implode_pass<V>(expkey, xmminput, longoutput);
+
+        for (int i = 0; i < 16; i++)
+        {
+            cn_aes_10_rounds(expkey, xmminput);
+            cn_mix_and_propagate(xmminput);
+        }
+    }
+}
+
+#if CN_VAES_WIDTH != 0
+// VAES versions of explode/implode: the eight 16-byte blocks of the AES text
+// are processed as four 256-bit or two 512-bit vectors, with the round keys
+// broadcast to every 128-bit lane. Only used when cpu_features reports VAES.
+
+static inline __attribute__((always_inline, target("avx2,vaes"))) void cn_mix_and_propagate_256(__m256i *y)
+{
+    __m256i y0 = y[0];
+    y[0] = _mm256_xor_si256(y[0], _mm256_permute2x128_si256(y[0], y[1], 0x21));
+    y[1] = _mm256_xor_si256(y[1], _mm256_permute2x128_si256(y[1], y[2], 0x21));
+    y[2] = _mm256_xor_si256(y[2], _mm256_permute2x128_si256(y[2], y[3], 0x21));
+    y[3] = _mm256_xor_si256(y[3], _mm256_permute2x128_si256(y[3], y0, 0x21));
+}
+
+static inline __attribute__((always_inline, target("avx2,vaes"))) void cn_aes_10_rounds_256(const __m256i *k, __m256i *y)
+{
+    for(int j = 0; j < 10; j++)
+    {
+        y[0] = _mm256_aesenc_epi128(y[0], k[j]);
+        y[1] = _mm256_aesenc_epi128(y[1], k[j]);
+        y[2] = _mm256_aesenc_epi128(y[2], k[j]);
+        y[3] = _mm256_aesenc_epi128(y[3], k[j]);
+    }
+}
+
+template<class V>
+static __attribute__((noinline, target("avx2,vaes"))) void cn_explode_scratchpad_vaes256(const __m128i *expkey, __m128i *xmminput, __m128i *longoutput)
+{
+    __m256i k[10], y[4];
+
+    for (int j = 0; j < 10; j++)
+        k[j] = _mm256_broadcastsi128_si256(_mm_load_si128(&expkey[j]));
+    for (int j = 0; j < 4; j++)
+        y[j] = _mm256_loadu_si256((__m256i *)&xmminput[j << 1]);
+
+    if (V::HEAVY)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            cn_aes_10_rounds_256(k, y);
+            cn_mix_and_propagate_256(y);
+        }
+    }
+
+    for (size_t i = 0; __builtin_expect(i < V::INIT_ROUNDS, 1); ++i)
+    {
+        cn_aes_10_rounds_256(k, y);
+
+        _mm256_store_si256((__m256i *)&longoutput[(i << 3)], y[0]);
+        _mm256_store_si256((__m256i *)&longoutput[(i << 3) + 2], y[1]);
+        _mm256_store_si256((__m256i *)&longoutput[(i << 3) + 4], y[2]);
+        _mm256_store_si256((__m256i *)&longoutput[(i << 3) + 6], y[3]);
+    }
+
+    for (int j = 0; j < 4; j++)
+        _mm256_storeu_si256((__m256i *)&xmminput[j << 1], y[j]);
+}
+
+template<class V>
+static inline __attribute__((always_inline, target("avx2,vaes"))) void cn_implode_pass_vaes256(const __m256i *k, __m256i *y, const __m128i *longoutput)
+{
+    for (size_t i = 0; __builtin_expect(i < V::INIT_ROUNDS, 1); ++i)
+    {
+        y[0] = _mm256_xor_si256(_mm256_load_si256((const __m256i *)&longoutput[(i << 3)]), y[0]);
+        y[1] = _mm256_xor_si256(_mm256_load_si256((const __m256i *)&longoutput[(i << 3) + 2]), y[1]);
+        y[2] = _mm256_xor_si256(_mm256_load_si256((const __m256i *)&longoutput[(i << 3) + 4]), y[2]);
+        y[3] = _mm256_xor_si256(_mm256_load_si256((const __m256i *)&longoutput[(i << 3) + 6]), y[3]);
+
+        cn_aes_10_rounds_256(k, y);
+
+        if (V::HEAVY)
+            cn_mix_and_propagate_256(y);
+    }
+}
+
+template<class V>
+static __attribute__((noinline, target("avx2,vaes"))) void cn_implode_scratchpad_vaes256(const __m128i *expkey, __m128i *xmminput, const __m128i *longoutput)
+{
+    __m256i k[10], y[4];
+
+    for (int j = 0; j < 10; j++)
+        k[j] = _mm256_broadcastsi128_si256(_mm_load_si128(&expkey[j]));
+    for (int j = 0; j < 4; j++)
+        y[j] = _mm256_loadu_si256((__m256i *)&xmminput[j << 1]);
+
+    cn_implode_pass_vaes256<V>(k, y, longoutput);
+
+    if (V::HEAVY)
+    {
+        cn_implode_pass_vaes256<V>(k, y, longoutput);
+
+        for (int i = 0; i < 16; i++)
+        {
+            cn_aes_10_rounds_256(k, y);
+            cn_mix_and_propagate_256(y);
+        }
+    }
+
+    for (int j = 0; j < 4; j++)
+        _mm256_storeu_si256((__m256i *)&xmminput[j << 1], y[j]);
+}
+
+static inline __attribute__((always_inline, target("avx512f,vaes"))) void cn_mix_and_propagate_512(__m512i *z)
+{
+    // z[0] = blocks 0..3, z[1] = blocks 4..7; each block absorbs its successor
+    // The maskz forms with a full mask compile to the same instruction. The
+    // plain ones pass GCC 12 an _mm512_undefined_epi32() it warns about (also
+    // why the round keys use _mm512_maskz_broadcast_i32x4).
+    __m512i next0 = _mm512_maskz_alignr_epi64(0xff, z[1], z[0], 2);
+    __m512i next1 = _mm512_maskz_alignr_epi64(0xff, z[0], z[1], 2);
+    z[0] = _mm512_xor_si512(z[0], next0);
+    z[1] = _mm512_xor_si512(z[1], next1);
+}
+
+static inline __attribute__((always_inline, target("avx512f,vaes"))) void cn_aes_10_rounds_512(const __m512i *k, __m512i *z)
+{
+    for(int j = 0; j < 10; j++)
+    {
+        z[0] = _mm512_aesenc_epi128(z[0], k[j]);
+        z[1] = _mm512_aesenc_epi128(z[1], k[j]);
+    }
+}
+
+template<class V>
+static __attribute__((noinline, target("avx512f,vaes"))) void cn_explode_scratchpad_vaes512(const __m128i *expkey, __m128i *xmminput, __m128i *longoutput)
+{
+    __m512i k[10], z[2];
+
+    for (int j = 0; j < 10; j++)
+        k[j] = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(&expkey[j]));
+    z[0] = _mm512_loadu_si512(&xmminput[0]);
+    z[1] = _mm512_loadu_si512(&xmminput[4]);
+
+    if (V::HEAVY)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            cn_aes_10_rounds_512(k, z);
+            cn_mix_and_propagate_512(z);
+        }
+    }
+
+    for (size_t i = 0; __builtin_expect(i < V::INIT_ROUNDS, 1); ++i)
+    {
+        cn_aes_10_rounds_512(k, z);
+
+        _mm512_store_si512(&longoutput[(i << 3)], z[0]);
+        _mm512_store_si512(&longoutput[(i << 3) + 4], z[1]);
+    }
+
+    _mm512_storeu_si512(&xmminput[0], z[0]);
+    _mm512_storeu_si512(&xmminput[4], z[1]);
+}
+
+template<class V>
+static inline __attribute__((always_inline, target("avx512f,vaes"))) void cn_implode_pass_vaes512(const __m512i *k, __m512i *z, const __m128i *longoutput)
+{
+    for (size_t i = 0; __builtin_expect(i < V::INIT_ROUNDS, 1); ++i)
+    {
+        z[0] = _mm512_xor_si512(_mm512_load_si512(&longoutput[(i << 3)]), z[0]);
+        z[1] = _mm512_xor_si512(_mm512_load_si512(&longoutput[(i << 3) + 4]), z[1]);
+
+        cn_aes_10_rounds_512(k, z);
+
+        if (V::HEAVY)
+            cn_mix_and_propagate_512(z);
+    }
+}
+
+template<class V>
+static __attribute__((noinline, target("avx512f,vaes"))) void cn_implode_scratchpad_vaes512(const __m128i *expkey, __m128i *xmminput, const __m128i *longoutput)
+{
+    __m512i k[10], z[2];
+
+    for (int j = 0; j < 10; j++)
+        k[j] = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(&expkey[j]));
+    z[0] = _mm512_loadu_si512(&xmminput[0]);
+    z[1] = _mm512_loadu_si512(&xmminput[4]);
+
+    cn_implode_pass_vaes512<V>(k, z, longoutput);
+
+    if (V::HEAVY)
+    {
+        cn_implode_pass_vaes512<V>(k, z, longoutput);
+
+        for (int i = 0; i < 16; i++)
+        {
+            cn_aes_10_rounds_512(k, z);
+            cn_mix_and_propagate_512(z);
+        }
+    }
+
+    _mm512_storeu_si512(&xmminput[0], z[0]);
+    _mm512_storeu_si512(&xmminput[4], z[1]);
+}
+
+#endif
+
+// The AVX-512 backend always has VAES; AVX2 hosts may or may not (Zen 3 does)
+template<class V>
+static inline void cn_explode(const __m128i *expkey, __m128i *xmminput, __m128i *longoutput)
+{
+#if CN_VAES_WIDTH == 512
+    cn_explode_scratchpad_vaes512<V>(expkey, xmminput, longoutput);
+#elif CN_VAES_WIDTH == 256
+    if (cpu_features.vaes)
+        cn_explode_scratchpad_vaes256<V>(expkey, xmminput, longoutput);
+    else
+        cn_explode_scratchpad<V>(expkey, xmminput, longoutput);
+#else
+    cn_explode_scratchpad<V>(expkey, xmminput, longoutput);
+#endif
+}
+
+template<class V>
+static inline void cn_implode(const __m128i *expkey, __m128i *xmminput, const __m128i *longoutput)
+{
+#if CN_VAES_WIDTH == 512
+    cn_implode_scratchpad_vaes512<V>(expkey, xmminput, longoutput);
+#elif CN_VAES_WIDTH == 256
+    if (cpu_features.vaes)
+        cn_implode_scratchpad_vaes256<V>(expkey, xmminput, longoutput);
+    else
+        cn_implode_scratchpad<V>(expkey, xmminput, longoutput);
+#else
+    cn_implode_scratchpad<V>(expkey, xmminput, longoutput);
+#endif
+}
+
+// Runs WAYS independent hashes over WAYS scratchpads in lockstep.
+// Each main loop iteration is split in two halves so that the dependent
+// load -> aesenc -> load -> mulq chain of one hash overlaps with the others.
+template<class V, int WAYS>
+static inline __attribute__((always_inline)) void cn_hash_ways(const char* const* input, char* const* output, const uint32_t* len, uint8_t * const *long_state)
+{
+    union cn_slow_hash_state state[WAYS];
+    uint8_t text[WAYS][INIT_SIZE_BYTE] __attribute((aligned(16)));
+    uint8_t ExpandedKey[256] __attribute((aligned(16)));
+    uint8_t *l[WAYS];
+    uint64_t a[WAYS][2] __attribute((aligned(16)));
+    uint64_t c[WAYS][2] __attribute((aligned(16)));
+    uint64_t idx[WAYS];
+    __m128i b_x[WAYS], c_x[WAYS];
+    struct cn_phase_stats *stats = NULL;
+    struct cn_phase_clock clock = { 0, 0 };
+
+    if (__builtin_expect(cn_stats_enabled, 0))
+    {
+        stats = cn_stats_thread();
+        cn_phase_start(&clock);
+    }
+
+    for (int w = 0; w < WAYS; w++)
+    {
+        l[w] = long_state[w];
+        CNKeccak(state[w].w, input[w], len[w]);
+        if (stats) cn_phase_mark(stats, CN_PHASE_KECCAK, &clock);
+
+        memcpy(text[w], state[w].init, INIT_SIZE_BYTE);
+        memcpy(ExpandedKey, state[w].b, AES_KEY_SIZE);
+        ExpandAESKey256(ExpandedKey);
+        cn_explode<V>((__m128i *)ExpandedKey, (__m128i *)text[w], (__m128i *)l[w]);
+        if (stats) cn_phase_mark(stats, CN_PHASE_EXPLODE, &clock);
+
+        a[w][0] = state[w].w[0] ^ state[w].w[4];
+        a[w][1] = state[w].w[1] ^ state[w].w[5];
+        b_x[w] = _mm_set_epi64x(state[w].w[3] ^ state[w].w[7], state[w].w[2] ^ state[w].w[6]);
+        idx[w] = a[w][0];
+    }
+
+    for(size_t i = 0; __builtin_expect(i < V::MAIN_ROUNDS, 1); i++)
+    {
+        for (int w = 0; w < WAYS; w++)
+        {
+            c_x[w] = _mm_load_si128((__m128i *)&l[w][idx[w] & V::MASK]);
+            c_x[w] = cn_aesenc(c_x[w], _mm_load_si128((__m128i *)a[w]));
+            _mm_store_si128((__m128i *)c[w], c_x[w]);
+            _mm_store_si128((__m128i *)&l[w][idx[w] & V::MASK], _mm_xor_si128(b_x[w], c_x[w]));
+            __builtin_prefetch(&l[w][c[w][0] & V::MASK], 0, 1);
+        }
+
+        for (int w = 0; w < WAYS; w++)
+        {
+            uint64_t *nextblock = (uint64_t *)&l[w][c[w][0] & V::MASK];
+            uint64_t b0 = nextblock[0], b1 = nextblock[1], hi, lo;
+
+            __asm__("mulq %3\n\t"
+                : "=d" (hi),
+              "=a" (lo)
+                : "%a" (c[w][0]),
+              "rm" (b0)
+                : "cc" );
+
+            a[w][0] += hi;
+            a[w][1] += lo;
+            nextblock[0] = a[w][0];
+            nextblock[1] = a[w][1];
+            a[w][0] ^= b0;
+            a[w][1] ^= b1;
+            b_x[w] = c_x[w];
+            idx[w] = a[w][0];
+
+            if (V::HEAVY)
+            {
+                int64_t n = ((int64_t *)&l[w][idx[w] & V::MASK])[0];
+                int32_t d = ((int32_t *)&l[w][idx[w] & V::MASK])[2];
+                int64_t q = n / (d | 0x5);
+
+                ((int64_t *)&l[w][idx[w] & V::MASK])[0] = n ^ q;
+                idx[w] = d ^ q;
+            }
+
+            __builtin_prefetch(&l[w][idx[w] & V::MASK], 0, 3);
+        }
+    }
+    if (stats) cn_phase_mark(stats, CN_PHASE_MAIN, &clock);
+
+    // With several ways, the states are grouped by finalizer and each group is finished in one call
+    const uint8_t* final_input[4][WAYS];
+    uint8_t* final_output[4][WAYS];
+    int final_ways[4] = { 0, 0, 0, 0 };
+
+    for (int w = 0; w < WAYS; w++)
+    {
+        memcpy(text[w], state[w].init, INIT_SIZE_BYTE);
+        memcpy(ExpandedKey, &state[w].b[32], AES_KEY_SIZE);
+        ExpandAESKey256(ExpandedKey);
+        cn_implode<V>((__m128i *)ExpandedKey, (__m128i *)text[w], (__m128i *)l[w]);
+        if (stats) cn_phase_mark(stats, CN_PHASE_IMPLODE, &clock);
+
+        memcpy(state[w].init, text[w], INIT_SIZE_BYTE);
+        CNKeccakF1600(state[w].w);
+        if (stats) cn_phase_mark(stats, CN_PHASE_KECCAK, &clock);
+
+        if (WAYS > 1)
+        {
+            int f = state[w].b[0] & 3;
+            final_input[f][final_ways[f]] = state[w].b;
+            final_output[f][final_ways[f]++] = (uint8_t*)output[w];
+            continue;
+        }
+
+        extra_hashes[state[w].b[0] & 3](&state[w], 200, output[w]);
+        if (stats)
+        {
+            cn_phase_mark(stats, CN_PHASE_FINALIZE, &clock);
+            cn_stats_add(&stats->finalizer[state[w].b[0] & 3], 1);
+        }
+    }
+
+    for (int f = 0; WAYS > 1 && f < 4; f++)
+    {
+        if (final_ways[f] == 0)
+            continue;
+        extra_hashes_multi[f](final_input[f], final_output[f], final_ways[f]);
+        if (stats)
+        {
+            cn_phase_mark(stats, CN_PHASE_FINALIZE, &clock);
+            cn_stats_add(&stats->finalizer[f], final_ways[f]);
+        }
+    }
+
+    if (stats) cn_stats_add(&stats->hashes, WAYS);
+}
+
+template<class V>
+static void cn_hash(const char* input, char* output, uint32_t len)
+{
+    cn_hash_ways<V, 1>(&input, &output, &len, cn_scratchpad_get(V::MEMORY, 1));
+}
+
+template<class V>
+static void cn_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways)
+{
+    while (ways > 0) {
+        uint32_t n = ways < CN_MAX_WAYS ? ways : CN_MAX_WAYS;
+        uint8_t * const *long_state = cn_scratchpad_get(V::MEMORY, n);
+
+        switch (n) {
+        case 1: cn_hash_ways<V, 1>(inputs, outputs, lens, long_state); break;
+        case 2: cn_hash_ways<V, 2>(inputs, outputs, lens, long_state); break;
+        case 3: cn_hash_ways<V, 3>(inputs, outputs, lens, long_state); break;
+        case 4: cn_hash_ways<V, 4>(inputs, outputs, lens, long_state); break;
+        default: cn_hash_ways<V, 5>(inputs, outputs, lens, long_state); break;
+        }
+        inputs += n;
+        outputs += n;
+        lens += n;
+        ways -= n;
+    }
+}
+
+#define CN_DEFINE_BACKEND(backend, label) \
+    extern "C" const struct cn_backend backend = { \
+        label, \
+        { cn_hash<cn_original>, cn_hash_multi<cn_original> }, \
+        { cn_hash<cn_light>, cn_hash_multi<cn_light> }, \
+        { cn_hash<cn_heavy>, cn_hash_multi<cn_heavy> } \
+    };
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef CRYPTONIGHT_HEAVY_H
+#define CRYPTONIGHT_HEAVY_H
+
+#include "cryptonight.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+void cryptonight_heavy_hash(const char* input, char* output, uint32_t len);
+void cryptonight_heavy_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
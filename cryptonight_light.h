@@ -1,6 +1,8 @@
 #ifndef CRYPTONIGHT_LIGHT_H
 #define CRYPTONIGHT_LIGHT_H
 
+#include "cryptonight.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,6 +10,7 @@ extern "C" {
 #include <stdint.h>
 
 void cryptonight_light_hash(const char* input, char* output, uint32_t len);
+void cryptonight_light_hash_multi(const char* const* inputs, char* const* outputs, const uint32_t* lens, uint32_t ways);
 void cryptonight_light_fast_hash(const char* input, char* output, uint32_t len);
 
 #ifdef __cplusplus
@@ -0,0 +1,338 @@
+// Per-thread CryptoNight scratchpads backed by a shared, pre-faulted pool.
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "cryptonight.h"
+#include "cryptonight_scratchpad.h"
+
+#define HUGE_PAGE_SIZE (1 << 21)
+
+/* From <numaif.h>; called through syscall() so libnuma isn't needed */
+#define CN_MPOL_PREFERRED 1
+#define CN_MPOL_F_NODE (1 << 0)
+#define CN_MPOL_F_ADDR (1 << 1)
+#define CN_MAX_NODES 1024
+
+struct cn_scratchpad {
+    uint8_t *memory;
+    size_t size;
+    int pages;
+    int node;
+    struct cn_scratchpad *next;
+};
+
+struct cn_thread_pads {
+    struct cn_scratchpad *pad[CN_MAX_WAYS];
+    uint8_t *memory[CN_MAX_WAYS];
+    uint32_t thread;
+    struct cn_thread_pads *next;
+};
+
+/* pool_lock guards the free list, the thread list and every thread's pad[] */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cn_scratchpad *pool_free = NULL;
+static struct cn_thread_pads *pool_threads = NULL;
+static uint32_t pool_thread_count = 0;
+
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+static __thread struct cn_thread_pads *thread_pads = NULL;
+static __thread int thread_node = -1;
+
+static size_t round_size(size_t size) {
+    return (size + CN_SCRATCHPAD_SIZE - 1) & ~((size_t)CN_SCRATCHPAD_SIZE - 1);
+}
+
+static void prefault(uint8_t *memory, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t i;
+
+    for (i = 0; i < size; i += page)
+        ((volatile uint8_t *)memory)[i] = 0;
+}
+
+/*
+ * Asks the kernel to place the pages of a not yet faulted region on `node`.
+ * MPOL_PREFERRED rather than MPOL_BIND: a node without free (huge) pages
+ * falls back to another one instead of failing the fault.
+ */
+static void bind_node(uint8_t *memory, size_t size, int node) {
+#ifdef SYS_mbind
+    unsigned long mask[CN_MAX_NODES / (8 * sizeof(unsigned long))];
+
+    if (node < 0 || node >= CN_MAX_NODES)
+        return;
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    syscall(SYS_mbind, memory, size, CN_MPOL_PREFERRED, mask, CN_MAX_NODES, 0);
+#endif
+}
+
+/* NUMA node the page at `memory` lives on, -1 if unknown. */
+static int resident_node(uint8_t *memory) {
+#ifdef SYS_get_mempolicy
+    int node = -1;
+
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0, memory, CN_MPOL_F_NODE | CN_MPOL_F_ADDR) == 0)
+        return node;
+#endif
+    return -1;
+}
+
+/*
+ * Whether the mapping holding `memory` is backed by transparent huge pages
+ * throughout, per its AnonHugePages line in /proc/self/smaps. MADV_HUGEPAGE
+ * succeeds even when THP is disabled or khugepaged hasn't collapsed the
+ * range, so only this tells. Adjacent pads can share one mapping; it then
+ * counts only if all of them are backed.
+ */
+static int thp_backed(const uint8_t *memory) {
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    char line[PATH_MAX + 128];
+    unsigned long from, to, size = 0, huge_kb;
+    int inside = 0, backed = 0;
+
+    if (smaps == NULL)
+        return 0;
+    while (fgets(line, sizeof(line), smaps) != NULL) {
+        // field lines such as "Anonymous:" half-match this, so only a full
+        // match may touch the range
+        if (sscanf(line, "%lx-%lx ", &from, &to) == 2) {
+            if (inside)
+                break;
+            inside = (uintptr_t)memory >= from && (uintptr_t)memory < to;
+            size = to - from;
+        } else if (inside && sscanf(line, "AnonHugePages: %lu kB", &huge_kb) == 1) {
+            backed = huge_kb * 1024 >= size;
+            break;
+        }
+    }
+    fclose(smaps);
+    return backed;
+}
+
+/*
+ * Maps `size` bytes (a multiple of HUGE_PAGE_SIZE) preferring explicit huge
+ * pages, then a huge-page aligned region advised for transparent huge pages,
+ * then plain pages. The kind that was obtained goes to *pages; an advised
+ * region is CN_PAGES_MADVISED until thp_backed() confirms it.
+ * With node >= 0 the region is bound to that node before it's faulted in.
+ */
+static uint8_t *map_pages(size_t size, int *pages, int node) {
+    uint8_t *memory, *aligned;
+    size_t head;
+
+#ifdef MAP_HUGETLB
+    memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (node < 0 ? MAP_POPULATE : 0), -1, 0);
+    if (memory != MAP_FAILED) {
+        bind_node(memory, size, node);
+        *pages = CN_PAGES_HUGETLB;
+        return memory;
+    }
+#endif
+
+    memory = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+
+    aligned = (uint8_t *)(((uintptr_t)memory + HUGE_PAGE_SIZE - 1) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+    head = aligned - memory;
+    if (head != 0)
+        munmap(memory, head);
+    munmap(aligned + size, HUGE_PAGE_SIZE - head);
+
+    *pages = CN_PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+    if (madvise(aligned, size, MADV_HUGEPAGE) == 0)
+        *pages = CN_PAGES_MADVISED;
+#endif
+    bind_node(aligned, size, node);
+    return aligned;
+}
+
+static struct cn_scratchpad *pad_alloc(size_t size, int node) {
+    struct cn_scratchpad *pad = malloc(sizeof(struct cn_scratchpad));
+    if (pad == NULL)
+        return NULL;
+
+    pad->memory = map_pages(size, &pad->pages, node);
+    if (pad->memory == NULL) {
+        free(pad);
+        return NULL;
+    }
+
+    pad->size = size;
+    pad->node = node;
+    pad->next = NULL;
+    prefault(pad->memory, size);
+    return pad;
+}
+
+static void pool_put_locked(struct cn_scratchpad *pad) {
+    pad->next = pool_free;
+    pool_free = pad;
+}
+
+static void pool_put(struct cn_scratchpad *pad) {
+    pthread_mutex_lock(&pool_lock);
+    pool_put_locked(pad);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/*
+ * Takes the first pooled scratchpad that is large enough (and bound to
+ * `node`, for node-bound threads), or makes a new one.
+ */
+static struct cn_scratchpad *pool_take(size_t size, int node) {
+    struct cn_scratchpad **link, *pad = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    for (link = &pool_free; *link != NULL; link = &(*link)->next) {
+        if ((*link)->size >= size && (node < 0 || (*link)->node == node)) {
+            pad = *link;
+            *link = pad->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (pad == NULL)
+        pad = pad_alloc(size, node);
+    return pad;
+}
+
+static void thread_release(void *data) {
+    struct cn_thread_pads *pads = data, **link;
+    int w;
+
+    pthread_mutex_lock(&pool_lock);
+    for (link = &pool_threads; *link != NULL; link = &(*link)->next) {
+        if (*link == pads) {
+            *link = pads->next;
+            break;
+        }
+    }
+    for (w = 0; w < CN_MAX_WAYS; w++) {
+        if (pads->pad[w] != NULL)
+            pool_put_locked(pads->pad[w]);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    free(pads);
+}
+
+static void thread_key_init(void) {
+    pthread_key_create(&thread_key, thread_release);
+}
+
+uint8_t * const *cn_scratchpad_get(size_t size, uint32_t ways) {
+    struct cn_thread_pads *pads = thread_pads;
+    uint32_t w;
+
+    if (__builtin_expect(pads == NULL, 0)) {
+        pads = calloc(1, sizeof(struct cn_thread_pads));
+        if (pads == NULL)
+            abort();
+        pthread_once(&thread_key_once, thread_key_init);
+        pthread_setspecific(thread_key, pads);
+        thread_pads = pads;
+
+        pthread_mutex_lock(&pool_lock);
+        pads->thread = pool_thread_count++;
+        pads->next = pool_threads;
+        pool_threads = pads;
+        pthread_mutex_unlock(&pool_lock);
+    }
+
+    for (w = 0; w < ways; w++) {
+        if (__builtin_expect(pads->pad[w] == NULL || pads->pad[w]->size < size, 0)) {
+            struct cn_scratchpad *pad = pool_take(round_size(size), thread_node);
+            if (pad == NULL)
+                abort();
+
+            pthread_mutex_lock(&pool_lock);
+            if (pads->pad[w] != NULL)
+                pool_put_locked(pads->pad[w]);
+            pads->pad[w] = pad;
+            pthread_mutex_unlock(&pool_lock);
+            pads->memory[w] = pad->memory;
+        }
+    }
+
+    return pads->memory;
+}
+
+void cn_scratchpad_set_node(int node) {
+    thread_node = node;
+}
+
+void cn_scratchpad_warmup(uint32_t count) {
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        struct cn_scratchpad *pad = pad_alloc(CN_SCRATCHPAD_SIZE, -1);
+        if (pad == NULL)
+            break;
+        pool_put(pad);
+    }
+}
+
+/* khugepaged can collapse an advised pad later, so this is checked per report */
+static int pad_pages(const struct cn_scratchpad *pad) {
+    if (pad->pages == CN_PAGES_MADVISED && thp_backed(pad->memory))
+        return CN_PAGES_TRANSPARENT;
+    return pad->pages;
+}
+
+size_t cn_scratchpad_report(struct cn_scratchpad_info *info, size_t max) {
+    struct cn_thread_pads *pads;
+    struct cn_scratchpad *pad;
+    size_t count = 0;
+    int w;
+
+    pthread_mutex_lock(&pool_lock);
+    for (pads = pool_threads; pads != NULL; pads = pads->next) {
+        for (w = 0; w < CN_MAX_WAYS; w++) {
+            if (pads->pad[w] == NULL)
+                continue;
+            if (count < max) {
+                info[count].thread = pads->thread;
+                info[count].way = w;
+                info[count].size = pads->pad[w]->size;
+                info[count].pages = pad_pages(pads->pad[w]);
+                info[count].node = pads->pad[w]->node;
+                info[count].resident_node = resident_node(pads->pad[w]->memory);
+            }
+            count++;
+        }
+    }
+    for (pad = pool_free; pad != NULL; pad = pad->next) {
+        if (count < max) {
+            info[count].thread = CN_SCRATCHPAD_POOLED;
+            info[count].way = 0;
+            info[count].size = pad->size;
+            info[count].pages = pad_pages(pad);
+            info[count].node = pad->node;
+            info[count].resident_node = resident_node(pad->memory);
+        }
+        count++;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    return count;
+}
+
+const char *cn_scratchpad_pages_name(int pages) {
+    switch (pages) {
+    case CN_PAGES_HUGETLB: return "hugetlb";
+    case CN_PAGES_TRANSPARENT: return "transparent";
+    case CN_PAGES_MADVISED: return "madvised";
+    default: return "normal";
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef CRYPTONIGHT_SCRATCHPAD_H
+#define CRYPTONIGHT_SCRATCHPAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Scratchpads are handed out in multiples of this size (one per hash way). */
+#define CN_SCRATCHPAD_SIZE (1 << 21) /* 2 MiB */
+#define CN_SCRATCHPAD_ALIGN 64
+
+/*
+ * Returns `ways` scratchpads of at least `size` bytes owned by the calling
+ * thread. They are taken from the pool on first use, stay with the thread
+ * across calls and go back to the pool when the thread exits.
+ */
+uint8_t * const *cn_scratchpad_get(size_t size, uint32_t ways);
+
+/*
+ * Binds the calling thread's future scratchpads to a NUMA node: they are
+ * taken from pooled pads of that node or allocated there. -1 (the default)
+ * takes any pad and leaves placement to first touch.
+ */
+void cn_scratchpad_set_node(int node);
+
+/* Allocates and pre-faults `count` scratchpads into the shared pool. */
+void cn_scratchpad_warmup(uint32_t count);
+
+/*
+ * Page backing a scratchpad actually got: MAP_HUGETLB pages, transparent
+ * huge pages (seen in /proc/self/smaps), advised with MADV_HUGEPAGE but not
+ * (yet) backed by huge pages, or normal pages.
+ */
+enum {
+    CN_PAGES_NORMAL = 0,
+    CN_PAGES_TRANSPARENT = 1,
+    CN_PAGES_HUGETLB = 2,
+    CN_PAGES_MADVISED = 3
+};
+
+/* `thread` value of scratchpads sitting unused in the pool. */
+#define CN_SCRATCHPAD_POOLED UINT32_MAX
+
+struct cn_scratchpad_info {
+    uint32_t thread;
+    uint32_t way;
+    size_t size;
+    int pages;
+    int node;           /* node the pad was bound to, -1 if unbound */
+    int resident_node;  /* node its first page is on now, -1 if unknown */
+};
+
+/*
+ * Describes every scratchpad, per owning thread and then the pooled ones.
+ * Fills at most `max` entries and returns the total number of scratchpads.
+ */
+size_t cn_scratchpad_report(struct cn_scratchpad_info *info, size_t max);
+const char *cn_scratchpad_pages_name(int pages);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
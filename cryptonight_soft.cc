@@ -0,0 +1,11 @@
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// CryptoNight backend: table based software AES, plain x86-64 (SSE2)
+
+#define CN_SOFT_AES
+#define CN_VAES_WIDTH 0
+#include "cryptonight_core.h"
+
+CN_DEFINE_BACKEND(cn_backend_soft, "soft")
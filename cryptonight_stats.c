@@ -0,0 +1,96 @@
+// Per-thread CryptoNight phase counters. Hashing threads only ever touch
+// their own block; readers walk the list and subtract the reset baseline.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cryptonight_stats.h"
+
+struct cn_thread_stats {
+    struct cn_phase_stats stats;
+    struct cn_thread_stats *next;
+};
+
+int cn_stats_enabled = 0;
+
+/* stats_lock guards the thread list and the baseline, never the counters */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cn_thread_stats *stats_threads = NULL;
+static struct cn_phase_stats stats_baseline;
+static __thread struct cn_thread_stats *thread_stats = NULL;
+
+#define STATS_WORDS (sizeof(struct cn_phase_stats) / sizeof(uint64_t))
+
+__attribute__((constructor))
+static void cn_stats_init(void) {
+    const char *enabled = getenv("CN_PHASE_STATS");
+
+    if (enabled != NULL && atoi(enabled) != 0)
+        cn_stats_enable(1);
+}
+
+void cn_stats_enable(int enabled) {
+    __atomic_store_n(&cn_stats_enabled, enabled != 0, __ATOMIC_RELAXED);
+}
+
+struct cn_phase_stats *cn_stats_thread(void) {
+    if (thread_stats == NULL) {
+        struct cn_thread_stats *stats = calloc(1, sizeof(*stats));
+
+        if (stats == NULL)
+            abort();
+
+        // Blocks outlive their thread so totals don't drop when a thread exits
+        pthread_mutex_lock(&stats_lock);
+        stats->next = stats_threads;
+        stats_threads = stats;
+        pthread_mutex_unlock(&stats_lock);
+        thread_stats = stats;
+    }
+    return &thread_stats->stats;
+}
+
+static void sum_threads(struct cn_phase_stats *total) {
+    struct cn_thread_stats *t;
+    size_t i;
+
+    memset(total, 0, sizeof(*total));
+    for (t = stats_threads; t != NULL; t = t->next) {
+        const uint64_t *src = (const uint64_t *)&t->stats;
+        uint64_t *dst = (uint64_t *)total;
+
+        for (i = 0; i < STATS_WORDS; i++)
+            dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+}
+
+void cn_stats_collect(struct cn_phase_stats *total) {
+    const uint64_t *base = (const uint64_t *)&stats_baseline;
+    uint64_t *dst = (uint64_t *)total;
+    size_t i;
+
+    pthread_mutex_lock(&stats_lock);
+    sum_threads(total);
+    for (i = 0; i < STATS_WORDS; i++)
+        dst[i] -= base[i];
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void cn_stats_reset(void) {
+    pthread_mutex_lock(&stats_lock);
+    sum_threads(&stats_baseline);
+    pthread_mutex_unlock(&stats_lock);
+}
+
+const char *cn_phase_name(int phase) {
+    static const char *names[CN_PHASE_COUNT] = { "keccak", "explode", "main", "implode", "finalize" };
+
+    return phase >= 0 && phase < CN_PHASE_COUNT ? names[phase] : "unknown";
+}
+
+const char *cn_finalizer_name(int finalizer) {
+    static const char *names[4] = { "blake", "groestl", "jh", "skein" };
+
+    return finalizer >= 0 && finalizer < 4 ? names[finalizer] : "unknown";
+}
@@ -0,0 +1,80 @@
+#ifndef CRYPTONIGHT_STATS_H
+#define CRYPTONIGHT_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include <x86intrin.h>
+
+/* Stages of one CryptoNight hash, in pipeline order. */
+enum cn_phase {
+    CN_PHASE_KECCAK = 0,    /* absorbing the input and the final Keccak-f */
+    CN_PHASE_EXPLODE,
+    CN_PHASE_MAIN,          /* memory-hard loop */
+    CN_PHASE_IMPLODE,
+    CN_PHASE_FINALIZE,      /* BLAKE / Groestl / JH / Skein */
+    CN_PHASE_COUNT
+};
+
+struct cn_phase_stats {
+    uint64_t hashes;
+    uint64_t cycles[CN_PHASE_COUNT];
+    uint64_t ns[CN_PHASE_COUNT];
+    uint64_t finalizer[4];  /* indexed like extra_hashes */
+};
+
+/* Non-zero while phase timing is on (CN_PHASE_STATS=1 or cn_stats_enable). */
+extern int cn_stats_enabled;
+
+void cn_stats_enable(int enabled);
+
+/* The calling thread's counters. Only that thread writes them. */
+struct cn_phase_stats *cn_stats_thread(void);
+
+/* Sums every thread's counters since the last reset. */
+void cn_stats_collect(struct cn_phase_stats *total);
+void cn_stats_reset(void);
+
+const char *cn_phase_name(int phase);
+const char *cn_finalizer_name(int finalizer);
+
+struct cn_phase_clock {
+    uint64_t tsc;
+    uint64_t ns;
+};
+
+static inline uint64_t cn_stats_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void cn_stats_add(uint64_t *counter, uint64_t value) {
+    /* single writer: relaxed stores keep concurrent readers from seeing torn values */
+    __atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+}
+
+static inline void cn_phase_start(struct cn_phase_clock *clock) {
+    clock->tsc = __rdtsc();
+    clock->ns = cn_stats_now_ns();
+}
+
+/* Charges the time since the last mark to `phase` and restarts the clock. */
+static inline void cn_phase_mark(struct cn_phase_stats *stats, int phase, struct cn_phase_clock *clock) {
+    uint64_t tsc = __rdtsc(), ns = cn_stats_now_ns();
+
+    cn_stats_add(&stats->cycles[phase], tsc - clock->tsc);
+    cn_stats_add(&stats->ns[phase], ns - clock->ns);
+    clock->tsc = tsc;
+    clock->ns = ns;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
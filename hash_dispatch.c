@@ -0,0 +1,53 @@
+// Binds the hashing kernels to the implementations the host CPU can run,
+// so one build of the addon works from plain x86-64 up to AVX-512.
+
+#include <stddef.h>
+
+#include "cpu_features.h"
+#include "cryptonight_backend.h"
+#include "crypto/c_blake256.h"
+#include "crypto/c_jh.h"
+#include "crypto/c_keccak.h"
+#include "crypto/c_skein.h"
+#include "crypto/groestl_aesni.h"
+#include "hash_dispatch.h"
+
+static struct hash_dispatch_entry dispatch_table[] = {
+    { "cryptonight", NULL },
+    { "cryptonight_light", NULL },
+    { "cryptonight_heavy", NULL },
+    { "keccak", NULL },
+    { "blake256", "generic" },
+    { "groestl", "generic" },
+    { "jh", "generic" },
+    { "skein", "generic" },
+    { "keccak_batch", "generic" },
+};
+
+#define DISPATCH_COUNT ((int)(sizeof(dispatch_table) / sizeof(dispatch_table[0])))
+
+__attribute__((constructor))
+void hash_dispatch_init(void) {
+    const char *cn;
+
+    cpu_features_init();
+
+    cn = cryptonight_select(cpu_features.level, cpu_features.vaes);
+    dispatch_table[0].backend = cn;
+    dispatch_table[1].backend = cn;
+    dispatch_table[2].backend = cn;
+    dispatch_table[3].backend = keccakf_select(cpu_features.bmi2);
+    dispatch_table[4].backend = blake256_select(cpu_features.sse41, cpu_features.avx2);
+    dispatch_table[5].backend = groestl_aesni_select(cpu_features.aes && cpu_features.ssse3);
+    dispatch_table[6].backend = jh_select(cpu_features.avx2);
+    dispatch_table[7].backend = skein_select(cpu_features.avx2);
+    dispatch_table[8].backend = keccak_lanes_select(cpu_features.avx2, cpu_features.avx512f);
+}
+
+int hash_dispatch_report(struct hash_dispatch_entry *entries, int max) {
+    int i;
+
+    for (i = 0; i < DISPATCH_COUNT && i < max; i++)
+        entries[i] = dispatch_table[i];
+    return DISPATCH_COUNT;
+}
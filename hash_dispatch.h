@@ -0,0 +1,27 @@
+#ifndef HASH_DISPATCH_H
+#define HASH_DISPATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Which implementation each dispatched primitive ended up with. */
+struct hash_dispatch_entry {
+    const char *algorithm;
+    const char *backend;
+};
+
+/*
+ * Detects the CPU and binds every dispatched primitive to its best
+ * implementation. Runs at load; calling it again redoes the selection.
+ */
+void hash_dispatch_init(void);
+
+/* Fills up to `max` entries, returns how many there are in total. */
+int hash_dispatch_report(struct hash_dispatch_entry *entries, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
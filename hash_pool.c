@@ -0,0 +1,268 @@
+// The addon's own hashing pool. Submissions go into a lock-free bounded
+// MPMC ring (Vyukov's sequence-numbered cells). A worker moves a few jobs
+// at a time into its own ring and other workers steal from those rings when
+// the shared one is empty, so a burst spreads over every worker. Completed
+// jobs go onto a lock-free stack the owner drains from one uv_async_t.
+
+#define _GNU_SOURCE
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "hash_pool.h"
+
+#define SUBMIT_SLOTS 4096       /* powers of two */
+#define LOCAL_SLOTS 64
+#define GRAB 4                  /* jobs a worker takes from the shared ring at once */
+
+struct hp_cell {
+    size_t seq;
+    struct hash_job *job;
+};
+
+struct hp_ring {
+    struct hp_cell *cells;
+    size_t mask;
+    size_t head __attribute__((aligned(64)));   /* next slot to fill */
+    size_t tail __attribute__((aligned(64)));   /* next slot to take */
+};
+
+struct hp_worker {
+    struct hp_ring local;
+    uint32_t index;
+    int cpu;
+    pthread_t thread;
+    uint64_t completed;
+    uint64_t stolen;
+} __attribute__((aligned(64)));
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static struct hp_ring submitted;
+static struct hp_worker *workers = NULL;
+static uint32_t worker_count = 0;
+static int running = 0;
+static void (*completed_notify)(void) = NULL;
+
+static int64_t pending = 0;         /* submitted, not yet started */
+static uint32_t sleepers = 0;
+static uint64_t submit_count = 0, reject_count = 0;
+static struct hash_job *completed_stack = NULL;
+
+static void ring_init(struct hp_ring *ring, size_t slots) {
+    size_t i;
+
+    ring->cells = malloc(slots * sizeof(*ring->cells));
+    if (ring->cells == NULL)
+        abort();
+    for (i = 0; i < slots; i++)
+        ring->cells[i].seq = i;
+    ring->mask = slots - 1;
+    ring->head = ring->tail = 0;
+}
+
+static int ring_push(struct hp_ring *ring, struct hash_job *job) {
+    size_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        struct hp_cell *cell = &ring->cells[pos & ring->mask];
+        intptr_t dif = (intptr_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (intptr_t)pos;
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->job = job;
+                __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;           // full
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static struct hash_job *ring_pop(struct hp_ring *ring) {
+    size_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+    for (;;) {
+        struct hp_cell *cell = &ring->cells[pos & ring->mask];
+        intptr_t dif = (intptr_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (intptr_t)(pos + 1);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                struct hash_job *job = cell->job;
+                __atomic_store_n(&cell->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+                return job;
+            }
+        } else if (dif < 0) {
+            return NULL;        // empty
+        } else {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Own ring first, then a few jobs from the shared ring, then the other workers
+static struct hash_job *next_job(struct hp_worker *self) {
+    struct hash_job *job;
+    uint32_t i;
+
+    if ((job = ring_pop(&self->local)) != NULL)
+        return job;
+    if ((job = ring_pop(&submitted)) != NULL) {
+        struct hash_job *more;
+
+        for (i = 1; i < GRAB && (more = ring_pop(&submitted)) != NULL; i++) {
+            if (!ring_push(&self->local, more)) {
+                // cannot happen, only this worker fills its ring and it was empty
+                abort();
+            }
+        }
+        return job;
+    }
+    for (i = 1; i < worker_count; i++) {
+        struct hp_worker *victim = &workers[(self->index + i) % worker_count];
+
+        if ((job = ring_pop(&victim->local)) != NULL) {
+            __atomic_add_fetch(&self->stolen, 1, __ATOMIC_RELAXED);
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static void complete(struct hash_job *job) {
+    job->next = __atomic_load_n(&completed_stack, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&completed_stack, &job->next, job, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    completed_notify();
+}
+
+static void *worker_main(void *data) {
+    struct hp_worker *self = data;
+
+    if (self->cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(self->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    for (;;) {
+        struct hash_job *job = next_job(self);
+
+        if (job == NULL) {
+            // Sleep until a submission. sleepers and pending are both
+            // seq_cst, so either this worker sees the new job or the
+            // submitter sees the sleeper and signals under the lock.
+            pthread_mutex_lock(&pool_lock);
+            __atomic_add_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&pending, __ATOMIC_SEQ_CST) <= 0)
+                pthread_cond_wait(&pool_wake, &pool_lock);
+            __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&pool_lock);
+            continue;
+        }
+        __atomic_sub_fetch(&pending, 1, __ATOMIC_SEQ_CST);
+        job->run(job);
+        __atomic_add_fetch(&self->completed, 1, __ATOMIC_RELAXED);
+        complete(job);
+    }
+    return NULL;
+}
+
+uint32_t hash_pool_start(const struct hash_pool_config *config, void (*notify)(void)) {
+    pthread_attr_t attr;
+    uint32_t threads, i, started = 0;
+
+    pthread_mutex_lock(&pool_lock);
+    if (running) {
+        pthread_mutex_unlock(&pool_lock);
+        return worker_count;
+    }
+
+    threads = config->threads;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? cpus : 1;
+    }
+    completed_notify = notify;
+    ring_init(&submitted, SUBMIT_SLOTS);
+    workers = calloc(threads, sizeof(*workers));
+    if (workers == NULL)
+        abort();
+
+    pthread_attr_init(&attr);
+    if (config->stack_size > 0)
+        pthread_attr_setstacksize(&attr, config->stack_size < (size_t)PTHREAD_STACK_MIN ? (size_t)PTHREAD_STACK_MIN : config->stack_size);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    // Rings are set up for every worker before any starts stealing
+    for (i = 0; i < threads; i++) {
+        ring_init(&workers[i].local, LOCAL_SLOTS);
+        workers[i].index = i;
+        workers[i].cpu = config->cpus != NULL && config->cpu_count > 0 ? config->cpus[i % config->cpu_count] : -1;
+    }
+    worker_count = threads;
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i].thread, &attr, worker_main, &workers[i]) == 0)
+            started++;
+    }
+    pthread_attr_destroy(&attr);
+
+    // Workers that failed to start have empty rings; the others skip them
+    running = started > 0;
+    pthread_mutex_unlock(&pool_lock);
+    return started;
+}
+
+int hash_pool_running(void) {
+    return __atomic_load_n(&running, __ATOMIC_ACQUIRE);
+}
+
+int hash_pool_submit(struct hash_job *job) {
+    if (!ring_push(&submitted, job)) {
+        __atomic_add_fetch(&reject_count, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    __atomic_add_fetch(&submit_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pending, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool_lock);
+        pthread_cond_signal(&pool_wake);
+        pthread_mutex_unlock(&pool_lock);
+    }
+    return 1;
+}
+
+struct hash_job *hash_pool_take_completed(void) {
+    struct hash_job *job = __atomic_exchange_n(&completed_stack, NULL, __ATOMIC_ACQUIRE), *oldest = NULL;
+
+    // The stack is newest first
+    while (job != NULL) {
+        struct hash_job *next = job->next;
+
+        job->next = oldest;
+        oldest = job;
+        job = next;
+    }
+    return oldest;
+}
+
+void hash_pool_report(struct hash_pool_stats *stats) {
+    uint32_t i;
+
+    stats->threads = worker_count;
+    stats->submitted = __atomic_load_n(&submit_count, __ATOMIC_RELAXED);
+    stats->rejected = __atomic_load_n(&reject_count, __ATOMIC_RELAXED);
+    stats->completed = 0;
+    stats->stolen = 0;
+    for (i = 0; i < worker_count; i++) {
+        stats->completed += __atomic_load_n(&workers[i].completed, __ATOMIC_RELAXED);
+        stats->stolen += __atomic_load_n(&workers[i].stolen, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef HASH_POOL_H
+#define HASH_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A job for the addon's own hashing pool, separate from the libuv pool so
+ * hashing neither waits behind nor starves fs, dns and zlib work. run() is
+ * called once, on one worker.
+ */
+struct hash_job {
+    void (*run)(struct hash_job *job);
+    void *data;                 /* owner's, untouched by the pool */
+    struct hash_job *next;      /* completed list */
+};
+
+struct hash_pool_config {
+    uint32_t threads;           /* 0: one per CPU */
+    const int *cpus;            /* worker i is pinned to cpus[i % cpu_count]; NULL: not pinned */
+    uint32_t cpu_count;
+    size_t stack_size;          /* 0: the system default */
+};
+
+/*
+ * Starts the workers. `notify` is called from a worker whenever a job has
+ * completed (so the owner should coalesce, e.g. with uv_async_send).
+ * Returns the number of workers, or 0 if none could start. Calling it again
+ * while running is a no-op that returns the current size.
+ */
+uint32_t hash_pool_start(const struct hash_pool_config *config, void (*notify)(void));
+
+/* Non-zero once hash_pool_start succeeded. */
+int hash_pool_running(void);
+
+/*
+ * Queues a job without taking a lock. Returns 0 if the submission queue is
+ * full; the caller should run the job some other way then.
+ */
+int hash_pool_submit(struct hash_job *job);
+
+/* Takes every completed job, oldest first, linked through `next`. */
+struct hash_job *hash_pool_take_completed(void);
+
+struct hash_pool_stats {
+    uint32_t threads;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t stolen;            /* jobs a worker took from another worker's queue */
+    uint64_t rejected;          /* submissions refused because the queue was full */
+};
+
+void hash_pool_report(struct hash_pool_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
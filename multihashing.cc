@@ -2,12 +2,32 @@
 #include <node_buffer.h>
 #include <v8.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <atomic>
+#include <thread>
 #include <nan.h>
 #include "multihashing.h"
 
 extern "C" {
     #include "cryptonight.h"
     #include "cryptonight_light.h"
+    #include "cryptonight_heavy.h"
+    #include "cryptonight_scratchpad.h"
+    #include "cryptonight_backend.h"
+    #include "cpu_features.h"
+    #include "hash_dispatch.h"
+    #include "share_check.h"
+    #include "cryptonight_stats.h"
+    #include "cn_workers.h"
+    #include "crypto/hash-ops.h"
+    #include "block_template.h"
+    #include "nonce_scan.h"
+    #include "hash_pool.h"
+    #include "prio_queue.h"
 }
 
 #define THROW_ERROR_EXCEPTION(x) Nan::ThrowError(x)
@@ -20,19 +40,58 @@ using namespace node;
 using namespace v8;
 using namespace Nan;
 
+// The optional destination of a hash, info[index] and info[index + 1]: a
+// Buffer and an offset (default 0) with room for 32 bytes there. Returns an
+// error message, or NULL with `out` left empty if there is no destination.
+static const char * parse_hash_output(const Nan::FunctionCallbackInfo<v8::Value>& info, int index, int argc, Local<Object> *out, uint32_t *offset) {
+    *offset = 0;
+    if (argc <= index)
+        return NULL;
+    if (!Buffer::HasInstance(info[index]))
+        return "Output should be a buffer object.";
+    if (argc > index + 1) {
+        if (!info[index + 1]->IsUint32())
+            return "Output offset should be a number.";
+        *offset = Nan::To<uint32_t>(info[index + 1]).FromJust();
+    }
+    if ((size_t)*offset + 32 > Buffer::Length(info[index]))
+        return "Output buffer has no room for 32 bytes at that offset.";
+    *out = info[index].As<v8::Object>();
+    return NULL;
+}
+
+// Writes the hash into the caller's Buffer when there is one (and returns
+// that Buffer), otherwise into a new one.
+static v8::Local<v8::Value> hash_result(Local<Object> out, uint32_t offset, const char *hash) {
+    if (out.IsEmpty())
+        return Nan::CopyBuffer(hash, 32).ToLocalChecked();
+    memcpy(Buffer::Data(out) + offset, hash, 32);
+    return out;
+}
+
+// cryptonight(input[, fast][, out[, offset]]): with `out` the hash is written
+// into that Buffer at `offset` and `out` is returned, no Buffer is allocated.
 NAN_METHOD(cryptonight) {
 
     bool fast = false;
+    int next = 1;
+    Local<Object> out;
+    uint32_t out_offset;
 
     if (info.Length() < 1)
         return THROW_ERROR_EXCEPTION("You must provide one argument.");
     
-    if (info.Length() >= 2) {
+    if (info.Length() >= 2 && !Buffer::HasInstance(info[1])) {
         if(!info[1]->IsBoolean())
             return THROW_ERROR_EXCEPTION("Argument 2 should be a boolean");
         fast = info[1]->ToBoolean()->BooleanValue();
+        next = 2;
     }
 
+    const char * error = parse_hash_output(info, next, info.Length(), &out, &out_offset);
+    if (error != NULL)
+        return THROW_ERROR_EXCEPTION(error);
+
     Local<Object> target = info[0]->ToObject();
 
     if(!Buffer::HasInstance(target))
@@ -48,107 +107,764 @@ NAN_METHOD(cryptonight) {
     else
         cryptonight_hash(input, output, input_len);
 
-    v8::Local<v8::Value> returnValue = Nan::CopyBuffer(output, 32).ToLocalChecked();
-    info.GetReturnValue().Set(
-        returnValue
-    );
+    info.GetReturnValue().Set(hash_result(out, out_offset, output));
 }
 
+// Settles a Promise from a libuv callback. The callback scope runs the
+// microtasks (the promise's then handlers) when it closes, as it does after
+// a Nan::Callback.
+static void settle_from_loop(Local<v8::Promise::Resolver> resolver, Local<Value> value, bool fulfilled) {
+    node::CallbackScope scope(v8::Isolate::GetCurrent(), Nan::New<Object>(), node::async_context{0, 0});
+
+    if (fulfilled)
+        resolver->Resolve(Nan::GetCurrentContext(), value).FromMaybe(false);
+    else
+        resolver->Reject(Nan::GetCurrentContext(), value).FromMaybe(false);
+}
+
+// What a hash cancelled by cancel(tag) completes with
+static Local<Value> cancel_error() {
+    Local<Value> error = Nan::Error("Hash cancelled.");
+
+    Nan::Set(error.As<v8::Object>(), Nan::New("code").ToLocalChecked(), Nan::New("ECANCELED").ToLocalChecked());
+    return error;
+}
+
+// Where the result of an async hash goes, on the main thread: written into
+// the caller's Buffer when there is one (see hash_result), then handed to
+// a callback, a Promise or a HashStream.
+class hash_reply {
+    public:
+        hash_reply(Local<Object> out, uint32_t out_offset) : out_offset(out_offset) {
+            if (!out.IsEmpty())
+                out_ref.Reset(out);
+        }
+        virtual ~hash_reply() {
+            out_ref.Reset();
+        }
+        virtual void done(const char *hash) = 0;
+        // cancel(tag) took the hash off the queue before it started
+        virtual void cancelled() = 0;
+
+    protected:
+        Local<Value> result(const char *hash) {
+            return hash_result(out_ref.IsEmpty() ? Local<Object>() : Nan::New(out_ref), out_offset, hash);
+        }
+
+    private:
+        Nan::Persistent<Object> out_ref;
+        uint32_t out_offset;
+};
+
+class callback_reply : public hash_reply {
+    public:
+        callback_reply(Local<v8::Function> fn, Local<Object> out, uint32_t out_offset)
+            : hash_reply(out, out_offset), callback(fn) {}
+
+        void done(const char *hash) {
+            v8::Local<v8::Value> argv[] = {
+                Nan::Null()
+              , result(hash)
+            };
+
+            callback.Call(2, argv);
+        }
+
+        void cancelled() {
+            v8::Local<v8::Value> argv[] = { cancel_error() };
+
+            callback.Call(1, argv);
+        }
+
+    private:
+        Nan::Callback callback;
+};
+
+class promise_reply : public hash_reply {
+    public:
+        promise_reply(Local<v8::Promise::Resolver> resolver, Local<Object> out, uint32_t out_offset)
+            : hash_reply(out, out_offset) {
+            this->resolver.Reset(resolver);
+        }
+        ~promise_reply() {
+            resolver.Reset();
+        }
+
+        void done(const char *hash) {
+            settle_from_loop(Nan::New(resolver), result(hash), true);
+        }
+
+        void cancelled() {
+            settle_from_loop(Nan::New(resolver), cancel_error(), false);
+        }
+
+    private:
+        Nan::Persistent<v8::Promise::Resolver> resolver;
+};
+
+static void hash_finished();
+
 class CNAsyncWorker : public Nan::AsyncWorker{
     public:
-        CNAsyncWorker(Nan::Callback *callback, char * input, uint32_t input_len)
-            : Nan::AsyncWorker(callback), input(input), input_len(input_len){}
-        ~CNAsyncWorker() {}
+        CNAsyncWorker(hash_reply *reply, Local<Object> input, void (*hash)(const char*, char*, uint32_t))
+            : Nan::AsyncWorker(NULL), hash(hash), input_len(Buffer::Length(input)), input(Buffer::Data(input)),
+              reply(reply) {
+            // Keeps the input alive while the pool thread reads it
+            SaveToPersistent("input", input);
+        }
+        ~CNAsyncWorker() {
+            delete reply;
+        }
 
     void Execute () {
-        cryptonight_hash(input, output, input_len);
+        hash(input, output, input_len);
       }
 
     void HandleOKCallback () {
         Nan::HandleScope scope;
 
-        v8::Local<v8::Value> argv[] = {
-            Nan::Null()
-          , v8::Local<v8::Value>(Nan::CopyBuffer(output, 32).ToLocalChecked())
-        };
-
-        callback->Call(2, argv);
+        hash_finished();
+        reply->done(output);
       }
 
     private:
+        void (*hash)(const char*, char*, uint32_t);
         uint32_t input_len;
         char * input;
+        hash_reply *reply;
         char output[32];
 };
 
+// Single async hashes run on the addon's own pool once startHashPool() was
+// called, so they stay out of the libuv pool's fs, dns and zlib work. Every
+// completion comes back through hash_pool_async, which only keeps the loop
+// alive while hashes are outstanding.
+struct hash_task {
+    struct hash_job job;
+    void (*hash)(const char* input, char* output, uint32_t len);
+    Nan::Persistent<v8::Object> input_ref;
+    const char *input;
+    uint32_t input_len;
+    char output[32];
+    hash_reply *reply;
+};
+
+static uv_async_t hash_pool_async;
+static uint32_t hash_pool_outstanding = 0;
+static uint32_t hash_pool_threads = 0;
+
+static void hash_task_run(struct hash_job *job) {
+    struct hash_task *task = (struct hash_task *)job->data;
+
+    task->hash(task->input, task->output, task->input_len);
+}
+
+static void hash_pool_notify(void) {
+    uv_async_send(&hash_pool_async);
+}
+
+static void hash_pool_completed(uv_async_t *handle) {
+    struct hash_job *job = hash_pool_take_completed();
+
+    Nan::HandleScope scope;
+
+    while (job != NULL) {
+        struct hash_job *next = job->next;
+        struct hash_task *task = (struct hash_task *)job->data;
+
+        if (--hash_pool_outstanding == 0)
+            uv_unref((uv_handle_t *)&hash_pool_async);
+
+        task->input_ref.Reset();
+        hash_finished();
+        task->reply->done(task->output);
+        delete task->reply;
+        delete task;
+        job = next;
+    }
+}
+
+// Queues one hash on the addon's pool. Returns false, leaving the reply
+// to the caller, when the pool isn't running or its queue is full.
+static bool hash_pool_queue(Local<Object> input, hash_reply *reply, void (*hash)(const char*, char*, uint32_t)) {
+    if (!hash_pool_running())
+        return false;
+
+    struct hash_task *task = new hash_task();
+    task->job.run = hash_task_run;
+    task->job.data = task;
+    task->hash = hash;
+    task->input_ref.Reset(input);
+    task->input = Buffer::Data(input);
+    task->input_len = Buffer::Length(input);
+    task->reply = reply;
+
+    if (!hash_pool_submit(&task->job)) {
+        task->input_ref.Reset();
+        delete task;
+        return false;
+    }
+    if (hash_pool_outstanding++ == 0)
+        uv_ref((uv_handle_t *)&hash_pool_async);
+    return true;
+}
+
+// Threads in the libuv pool: UV_THREADPOOL_SIZE, 4 by default.
+static uint32_t uv_pool_size() {
+    const char * size = getenv("UV_THREADPOOL_SIZE");
+    uint32_t count = size == NULL ? 4 : strtoul(size, NULL, 10);
+
+    return count == 0 ? 1 : count;
+}
+
+// Async hashes don't go straight into a FIFO thread pool. Only enough to
+// keep the pool busy run at a time (two per hashing pool worker, or one per
+// libuv thread), the rest wait in hash_queue by priority class, so a block
+// candidate doesn't sit behind thousands of queued shares. A queued hash
+// moves up a class for every `aging` ms it waits. cancel(tag) drops the
+// queued hashes with that tag.
+enum hash_priority { PRIORITY_BLOCK, PRIORITY_SHARE, PRIORITY_BACKGROUND };
+
+struct hash_options {
+    uint32_t priority;
+    std::string tag;            /* empty: untagged */
+};
+
+struct hash_request {
+    struct prio_item item;
+    Nan::Persistent<v8::Object> input;
+    hash_reply *reply;
+    void (*hash)(const char*, char*, uint32_t);
+    std::string tag;
+};
+
+static struct prio_queue hash_queue;
+static uint32_t hash_running = 0;
+
+static uint32_t hash_window() {
+    return hash_pool_running() ? 2 * hash_pool_threads : uv_pool_size();
+}
+
+static void hash_start(Local<Object> input, hash_reply *reply, void (*hash)(const char*, char*, uint32_t)) {
+    hash_running++;
+    if (!hash_pool_queue(input, reply, hash))
+        Nan::AsyncQueueWorker(new CNAsyncWorker(reply, input, hash));
+}
+
+// Hashes input off the main thread, on the addon's pool or the libuv pool,
+// and hands the result to reply.
+static void hash_async(Local<Object> input, hash_reply *reply, void (*hash)(const char*, char*, uint32_t), const struct hash_options &options) {
+    if (hash_running < hash_window() && prio_queue_size(&hash_queue) == 0)
+        return hash_start(input, reply, hash);
+
+    struct hash_request *request = new hash_request();
+    request->item.data = request;
+    request->input.Reset(input);
+    request->reply = reply;
+    request->hash = hash;
+    request->tag = options.tag;
+    prio_queue_push(&hash_queue, &request->item, options.priority, uv_now(uv_default_loop()));
+}
+
+// A started hash is done: start queued ones, best class first
+static void hash_finished() {
+    Nan::HandleScope scope;
+
+    hash_running--;
+    while (hash_running < hash_window()) {
+        struct prio_item *item = prio_queue_pop(&hash_queue, uv_now(uv_default_loop()));
+
+        if (item == NULL)
+            break;
+
+        struct hash_request *request = (struct hash_request *)item->data;
+        hash_start(Nan::New(request->input), request->reply, request->hash);
+        request->input.Reset();
+        delete request;
+    }
+}
+
+// { priority, tag }: priority is 'block', 'share' (the default) or
+// 'background'; tag is a string or number, usually the job id
+static bool is_hash_options(Local<Value> value) {
+    return value->IsObject() && !value->IsFunction() && !Buffer::HasInstance(value);
+}
+
+// A tag as it is compared: numbers and strings by their string form
+static bool parse_tag(Local<Value> value, std::string *tag) {
+    if (!value->IsString() && !value->IsNumber())
+        return false;
+
+    Nan::Utf8String text(value);
+
+    if (*text == NULL)
+        return false;
+    tag->assign(*text, text.length());
+    return true;
+}
+
+static const char * parse_hash_options(Local<Object> object, struct hash_options *options) {
+    Local<Value> value = Nan::Get(object, Nan::New("priority").ToLocalChecked()).ToLocalChecked();
+    Local<Value> tag = Nan::Get(object, Nan::New("tag").ToLocalChecked()).ToLocalChecked();
+
+    options->priority = PRIORITY_SHARE;
+    options->tag.clear();
+    if (!tag->IsUndefined() && !parse_tag(tag, &options->tag))
+        return "tag should be a string or a number.";
+    if (value->IsUndefined())
+        return NULL;
+
+    Nan::Utf8String name(value);
+
+    if (*name != NULL && strcmp(*name, "block") == 0)
+        options->priority = PRIORITY_BLOCK;
+    else if (*name != NULL && strcmp(*name, "background") == 0)
+        options->priority = PRIORITY_BACKGROUND;
+    else if (*name == NULL || strcmp(*name, "share") != 0)
+        return "priority should be block, share or background.";
+    return NULL;
+}
+
+// Cancelled hashes complete from hash_cancel_async on a later loop turn,
+// never inside cancel() itself
+static std::vector<hash_reply *> hash_cancelled;
+static uv_async_t hash_cancel_async;
+
+static void hash_cancel_completed(uv_async_t *handle) {
+    std::vector<hash_reply *> replies;
+
+    Nan::HandleScope scope;
+
+    replies.swap(hash_cancelled);
+    uv_unref((uv_handle_t *)&hash_cancel_async);
+    for (size_t i = 0; i < replies.size(); i++) {
+        replies[i]->cancelled();
+        delete replies[i];
+    }
+}
+
+static int hash_request_tagged(const struct prio_item *item, void *tag) {
+    return ((struct hash_request *)item->data)->tag == *(const std::string *)tag;
+}
+
+// cancel(tag): takes every queued hash with that tag off the queue. Each one
+// completes with an ECANCELED error (a rejected Promise, a null result in a
+// hashStream); hashes that already started finish normally. Returns how many
+// were cancelled.
+NAN_METHOD(cancel) {
+    std::string tag;
+
+    if (info.Length() < 1 || !parse_tag(info[0], &tag) || tag.empty())
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a tag, a string or a number.");
+
+    struct prio_item *item = prio_queue_extract(&hash_queue, hash_request_tagged, &tag);
+    uint32_t count = 0;
+
+    static bool async_ready = false;
+    if (item != NULL && !async_ready) {
+        uv_async_init(uv_default_loop(), &hash_cancel_async, hash_cancel_completed);
+        async_ready = true;
+    }
+    while (item != NULL) {
+        struct hash_request *request = (struct hash_request *)item->data;
+
+        item = item->next;
+        hash_cancelled.push_back(request->reply);
+        request->input.Reset();
+        delete request;
+        count++;
+    }
+    if (count > 0) {
+        uv_ref((uv_handle_t *)&hash_cancel_async);
+        uv_async_send(&hash_cancel_async);
+    }
+    info.GetReturnValue().Set(Nan::New<Number>(count));
+}
+
+// CNAsync/CNLAsync(input[, out[, offset]][, { priority, tag }], cb)
+static void hash_callback(const Nan::FunctionCallbackInfo<v8::Value>& info, void (*hash)(const char*, char*, uint32_t)) {
+
+    Local<Object> out;
+    uint32_t out_offset;
+    struct hash_options options = { PRIORITY_SHARE, std::string() };
+    int argc = info.Length() - 1;
+    const char * error = NULL;
+
+    if (info.Length() < 2 || !info[info.Length() - 1]->IsFunction())
+        return THROW_ERROR_EXCEPTION("You must provide an input, optionally an output and offset, and a callback.");
+    if (!Buffer::HasInstance(info[0]))
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a buffer object.");
+
+    if (argc >= 2 && is_hash_options(info[argc - 1]))
+        error = parse_hash_options(info[--argc].As<v8::Object>(), &options);
+    if (error == NULL && argc > 3)
+        error = "You must provide an input, optionally an output and offset, and a callback.";
+    if (error == NULL)
+        error = parse_hash_output(info, 1, argc, &out, &out_offset);
+    if (error != NULL)
+        return THROW_ERROR_EXCEPTION(error);
+
+    hash_async(info[0].As<v8::Object>(), new callback_reply(info[info.Length() - 1].As<v8::Function>(), out, out_offset), hash, options);
+}
+
+// cryptonightAsync/cryptonightLightAsync/cryptonightHeavyAsync(input[, out[, offset]][, { priority, tag }]):
+// a Promise of the hash, resolved straight from the worker's completion.
+static void hash_promise(const Nan::FunctionCallbackInfo<v8::Value>& info, void (*hash)(const char*, char*, uint32_t)) {
+
+    Local<Object> out;
+    uint32_t out_offset;
+    struct hash_options options = { PRIORITY_SHARE, std::string() };
+    int argc = info.Length();
+    const char * error = NULL;
+
+    if (info.Length() < 1 || !Buffer::HasInstance(info[0]))
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a buffer object.");
+
+    if (argc >= 2 && is_hash_options(info[argc - 1]))
+        error = parse_hash_options(info[--argc].As<v8::Object>(), &options);
+    if (error == NULL)
+        error = parse_hash_output(info, 1, argc, &out, &out_offset);
+    if (error != NULL)
+        return THROW_ERROR_EXCEPTION(error);
+
+    Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+
+    hash_async(info[0].As<v8::Object>(), new promise_reply(resolver, out, out_offset), hash, options);
+    info.GetReturnValue().Set(resolver->GetPromise());
+}
+
 NAN_METHOD(CNAsync) {
+    hash_callback(info, cryptonight_hash);
+}
 
-    if (info.Length() != 2)
-        return THROW_ERROR_EXCEPTION("You must provide two arguments.");
+NAN_METHOD(CNLAsync) {
+    hash_callback(info, cryptonight_light_hash);
+}
 
-    Local<Object> target = info[0]->ToObject();
-    Callback *callback = new Nan::Callback(info[1].As<v8::Function>());
+NAN_METHOD(cryptonightAsync) {
+    hash_promise(info, cryptonight_hash);
+}
 
-    char * input = Buffer::Data(target);
-    uint32_t input_len = Buffer::Length(target);
+NAN_METHOD(cryptonightLightAsync) {
+    hash_promise(info, cryptonight_light_hash);
+}
 
-    Nan::AsyncQueueWorker(new CNAsyncWorker(callback, input, input_len));
+NAN_METHOD(cryptonightHeavyAsync) {
+    hash_promise(info, cryptonight_heavy_hash);
 }
 
-class CNLAsyncWorker : public Nan::AsyncWorker{
+// hashStream([{ maxInFlight, variant, priority, tag }]): an async iterable of hashes.
+// write(input) starts a hash and returns a Promise that resolves once there
+// is room for it: at most maxInFlight (default 16) hashes are running or
+// waiting to be read at a time, so a producer that awaits write() is held
+// back by the consumer. `for await (const hash of stream)` (or next())
+// yields the hashes in write order and finishes after end(). Leaving the
+// loop early, which calls return(), drops whatever is still queued.
+class HashStream : public Nan::ObjectWrap {
     public:
-        CNLAsyncWorker(Nan::Callback *callback, char * input, uint32_t input_len)
-            : Nan::AsyncWorker(callback), input(input), input_len(input_len){}
-        ~CNLAsyncWorker() {}
+        static void Init(Local<Object> target) {
+            Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
 
-    void Execute () {
-        cryptonight_light_hash(input, output, input_len);
-      }
+            tpl->SetClassName(Nan::New("HashStream").ToLocalChecked());
+            tpl->InstanceTemplate()->SetInternalFieldCount(1);
+            Nan::SetPrototypeMethod(tpl, "write", Write);
+            Nan::SetPrototypeMethod(tpl, "end", End);
+            Nan::SetPrototypeMethod(tpl, "next", Next);
+            Nan::SetPrototypeMethod(tpl, "return", Return);
+            tpl->PrototypeTemplate()->Set(v8::Symbol::GetAsyncIterator(v8::Isolate::GetCurrent()), Nan::New<FunctionTemplate>(Self));
+            constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
+            Nan::Set(target, Nan::New("HashStream").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+        }
 
-    void HandleOKCallback () {
-        Nan::HandleScope scope;
+        static NAN_METHOD(Create) {
+            Local<Value> argv[] = { info.Length() >= 1 ? info[0] : Local<Value>(Nan::Undefined()) };
+            Nan::MaybeLocal<Object> stream = Nan::NewInstance(Nan::New(constructor()), 1, argv);
 
-        v8::Local<v8::Value> argv[] = {
-            Nan::Null()
-          , v8::Local<v8::Value>(Nan::CopyBuffer(output, 32).ToLocalChecked())
-        };
+            if (!stream.IsEmpty())
+                info.GetReturnValue().Set(stream.ToLocalChecked());
+        }
 
-        callback->Call(2, argv);
-      }
+        // A finished hash, in the order it was written; NULL if it was cancelled
+        void completed(uint64_t seq, const char *hash) {
+            struct result *slot = results[seq - first_seq];
+
+            if (hash != NULL)
+                memcpy(slot->hash, hash, 32);
+            slot->cancelled = hash == NULL;
+            slot->ready = true;
+            Unref();
+
+            node::CallbackScope scope(v8::Isolate::GetCurrent(), handle(), node::async_context{0, 0});
+            flush();
+        }
 
     private:
-        uint32_t input_len;
-        char * input;
-        char output[32];
+        struct result {
+            bool ready;
+            bool cancelled;
+            char hash[32];
+        };
+
+        struct waiting_input {
+            Nan::Persistent<Object> input;
+            Nan::Persistent<v8::Promise::Resolver> written;
+        };
+
+        HashStream() : hash(cryptonight_hash), max_in_flight(16), first_seq(0), ended(false), closed(false) {
+            options.priority = PRIORITY_SHARE;
+        }
+
+        // Runs from the garbage collector, so nothing is resolved here
+        ~HashStream() {
+            for (size_t i = 0; i < results.size(); i++)
+                delete results[i];
+            for (size_t i = 0; i < inputs.size(); i++) {
+                inputs[i]->input.Reset();
+                inputs[i]->written.Reset();
+                delete inputs[i];
+            }
+            for (size_t i = 0; i < readers.size(); i++) {
+                readers[i]->Reset();
+                delete readers[i];
+            }
+        }
+
+        static Nan::Persistent<v8::Function> & constructor() {
+            static Nan::Persistent<v8::Function> ctor;
+            return ctor;
+        }
+
+        static Local<Object> iter_result(Local<Value> value, bool done) {
+            Local<Object> result = Nan::New<Object>();
+
+            Nan::Set(result, Nan::New("value").ToLocalChecked(), value);
+            Nan::Set(result, Nan::New("done").ToLocalChecked(), Nan::New<v8::Boolean>(done));
+            return result;
+        }
+
+        static Local<v8::Promise> resolved(Local<Value> value) {
+            Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+
+            resolver->Resolve(Nan::GetCurrentContext(), value).FromMaybe(false);
+            return resolver->GetPromise();
+        }
+
+        void start(Local<Object> input);
+
+        // Hands finished hashes to waiting readers in order, starts waiting
+        // inputs as room frees up, and ends the readers once nothing is left.
+        void flush() {
+            Nan::HandleScope scope;
+
+            while (!results.empty() && results.front()->ready && (closed || !readers.empty())) {
+                struct result *slot = results.front();
+
+                results.pop_front();
+                first_seq++;
+                if (!closed) {
+                    Nan::Persistent<v8::Promise::Resolver> *reader = readers.front();
+
+                    readers.pop_front();
+                    Nan::New(*reader)->Resolve(Nan::GetCurrentContext(), iter_result(slot->cancelled ? Local<Value>(Nan::Null()) : Local<Value>(Nan::CopyBuffer(slot->hash, 32).ToLocalChecked()), false)).FromMaybe(false);
+                    reader->Reset();
+                    delete reader;
+                }
+                delete slot;
+            }
+            while (!inputs.empty() && results.size() < max_in_flight) {
+                struct waiting_input *waiting = inputs.front();
+
+                inputs.pop_front();
+                start(Nan::New(waiting->input));
+                Nan::New(waiting->written)->Resolve(Nan::GetCurrentContext(), Nan::Undefined()).FromMaybe(false);
+                waiting->input.Reset();
+                waiting->written.Reset();
+                delete waiting;
+            }
+            if (closed || (ended && results.empty() && inputs.empty()))
+                finish_readers();
+        }
+
+        void drop_inputs() {
+            while (!inputs.empty()) {
+                struct waiting_input *waiting = inputs.front();
+
+                inputs.pop_front();
+                Nan::New(waiting->written)->Resolve(Nan::GetCurrentContext(), Nan::Undefined()).FromMaybe(false);
+                waiting->input.Reset();
+                waiting->written.Reset();
+                delete waiting;
+            }
+        }
+
+        void finish_readers() {
+            while (!readers.empty()) {
+                Nan::Persistent<v8::Promise::Resolver> *reader = readers.front();
+
+                readers.pop_front();
+                Nan::New(*reader)->Resolve(Nan::GetCurrentContext(), iter_result(Nan::Undefined(), true)).FromMaybe(false);
+                reader->Reset();
+                delete reader;
+            }
+        }
+
+        static NAN_METHOD(New) {
+            if (!info.IsConstructCall())
+                return THROW_ERROR_EXCEPTION("HashStream must be called with new.");
+
+            HashStream *stream = new HashStream();
+
+            if (info.Length() >= 1 && info[0]->IsObject()) {
+                Local<Object> options = info[0].As<v8::Object>();
+                Local<Value> max = Nan::Get(options, Nan::New("maxInFlight").ToLocalChecked()).ToLocalChecked();
+                Local<Value> variant = Nan::Get(options, Nan::New("variant").ToLocalChecked()).ToLocalChecked();
+
+                if (!max->IsUndefined()) {
+                    if (!max->IsUint32() || Nan::To<uint32_t>(max).FromJust() == 0) {
+                        delete stream;
+                        return THROW_ERROR_EXCEPTION("maxInFlight should be a positive number.");
+                    }
+                    stream->max_in_flight = Nan::To<uint32_t>(max).FromJust();
+                }
+                const char * error = parse_hash_options(options, &stream->options);
+                if (error != NULL) {
+                    delete stream;
+                    return THROW_ERROR_EXCEPTION(error);
+                }
+                if (!variant->IsUndefined()) {
+                    Nan::Utf8String name(variant);
+
+                    if (*name != NULL && strcmp(*name, "cryptonight_light") == 0)
+                        stream->hash = cryptonight_light_hash;
+                    else if (*name != NULL && strcmp(*name, "cryptonight_heavy") == 0)
+                        stream->hash = cryptonight_heavy_hash;
+                    else if (*name == NULL || strcmp(*name, "cryptonight") != 0) {
+                        delete stream;
+                        return THROW_ERROR_EXCEPTION("variant should be cryptonight, cryptonight_light or cryptonight_heavy.");
+                    }
+                }
+            } else if (info.Length() >= 1 && !info[0]->IsUndefined()) {
+                delete stream;
+                return THROW_ERROR_EXCEPTION("Argument 1 should be an options object.");
+            }
+            stream->Wrap(info.This());
+            info.GetReturnValue().Set(info.This());
+        }
+
+        static NAN_METHOD(Write) {
+            HashStream *stream = Nan::ObjectWrap::Unwrap<HashStream>(info.Holder());
+
+            if (info.Length() < 1 || !Buffer::HasInstance(info[0]))
+                return THROW_ERROR_EXCEPTION("Argument 1 should be a buffer object.");
+            if (stream->ended)
+                return THROW_ERROR_EXCEPTION("write() after end().");
+
+            if (stream->results.size() < stream->max_in_flight && stream->inputs.empty()) {
+                stream->start(info[0].As<v8::Object>());
+                return info.GetReturnValue().Set(resolved(Nan::Undefined()));
+            }
+
+            Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+            struct waiting_input *waiting = new waiting_input();
+
+            waiting->input.Reset(info[0].As<v8::Object>());
+            waiting->written.Reset(resolver);
+            stream->inputs.push_back(waiting);
+            info.GetReturnValue().Set(resolver->GetPromise());
+        }
+
+        static NAN_METHOD(End) {
+            HashStream *stream = Nan::ObjectWrap::Unwrap<HashStream>(info.Holder());
+
+            stream->ended = true;
+            stream->flush();
+        }
+
+        static NAN_METHOD(Next) {
+            HashStream *stream = Nan::ObjectWrap::Unwrap<HashStream>(info.Holder());
+            Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+
+            stream->readers.push_back(new Nan::Persistent<v8::Promise::Resolver>(resolver));
+            stream->flush();
+            info.GetReturnValue().Set(resolver->GetPromise());
+        }
+
+        static NAN_METHOD(Return) {
+            HashStream *stream = Nan::ObjectWrap::Unwrap<HashStream>(info.Holder());
+
+            stream->ended = true;
+            stream->closed = true;
+            stream->drop_inputs();
+            stream->flush();
+            info.GetReturnValue().Set(resolved(iter_result(info.Length() >= 1 ? info[0] : Local<Value>(Nan::Undefined()), true)));
+        }
+
+        static NAN_METHOD(Self) {
+            info.GetReturnValue().Set(info.This());
+        }
+
+        void (*hash)(const char*, char*, uint32_t);
+        struct hash_options options;
+        uint32_t max_in_flight;
+        // results[i] is the hash of write number first_seq + i; each one
+        // holds a place in the window until it is read
+        std::deque<struct result *> results;
+        uint64_t first_seq;
+        std::deque<struct waiting_input *> inputs;
+        std::deque<Nan::Persistent<v8::Promise::Resolver> *> readers;
+        bool ended;
+        bool closed;
 };
 
-NAN_METHOD(CNLAsync) {
+class stream_reply : public hash_reply {
+    public:
+        stream_reply(HashStream *stream, uint64_t seq)
+            : hash_reply(Local<Object>(), 0), stream(stream), seq(seq) {}
 
-    if (info.Length() != 2)
-        return THROW_ERROR_EXCEPTION("You must provide two arguments.");
+        void done(const char *hash) {
+            stream->completed(seq, hash);
+        }
 
-    Local<Object> target = info[0]->ToObject();
-    Callback *callback = new Nan::Callback(info[1].As<v8::Function>());
+        void cancelled() {
+            stream->completed(seq, NULL);
+        }
 
-    char * input = Buffer::Data(target);
-    uint32_t input_len = Buffer::Length(target);
+    private:
+        HashStream *stream;
+        uint64_t seq;
+};
 
-    Nan::AsyncQueueWorker(new CNLAsyncWorker(callback, input, input_len));
+// Each running hash holds a reference on the stream, so it outlives its hashes
+void HashStream::start(Local<Object> input) {
+    struct result *slot = new result();
+
+    slot->ready = false;
+    results.push_back(slot);
+    Ref();
+    hash_async(input, new stream_reply(this, first_seq + results.size() - 1), hash, options);
 }
 
 NAN_METHOD(cryptonight_light) {
 
     bool fast = false;
+    int next = 1;
+    Local<Object> out;
+    uint32_t out_offset;
 
     if (info.Length() < 1)
         return THROW_ERROR_EXCEPTION("You must provide one argument.");
 
-    if (info.Length() >= 2) {
+    if (info.Length() >= 2 && !Buffer::HasInstance(info[1])) {
         if(!info[1]->IsBoolean())
             return THROW_ERROR_EXCEPTION("Argument 2 should be a boolean");
         fast = info[1]->ToBoolean()->BooleanValue();
+        next = 2;
     }
 
+    const char * error = parse_hash_output(info, next, info.Length(), &out, &out_offset);
+    if (error != NULL)
+        return THROW_ERROR_EXCEPTION(error);
+
     Local<Object> target = info[0]->ToObject();
 
     if(!Buffer::HasInstance(target))
@@ -164,18 +880,1088 @@ NAN_METHOD(cryptonight_light) {
     else
         cryptonight_light_hash(input, output, input_len);
 
-    v8::Local<v8::Value> returnValue = Nan::CopyBuffer(output, 32).ToLocalChecked();
-    info.GetReturnValue().Set(
-        returnValue
-    );
+    info.GetReturnValue().Set(hash_result(out, out_offset, output));
 }
 
+NAN_METHOD(cryptonight_heavy) {
+
+    Local<Object> out;
+    uint32_t out_offset;
+
+    if (info.Length() < 1)
+        return THROW_ERROR_EXCEPTION("You must provide one argument.");
+
+    const char * error = parse_hash_output(info, 1, info.Length(), &out, &out_offset);
+    if (error != NULL)
+        return THROW_ERROR_EXCEPTION(error);
+
+    Local<Object> target = info[0]->ToObject();
+
+    if(!Buffer::HasInstance(target))
+        return THROW_ERROR_EXCEPTION("Argument should be a buffer object.");
+
+    char * input = Buffer::Data(target);
+    char output[32];
+
+    uint32_t input_len = Buffer::Length(target);
+
+    cryptonight_heavy_hash(input, output, input_len);
+
+    info.GetReturnValue().Set(hash_result(out, out_offset, output));
+}
+
+static void hash_multi(const Nan::FunctionCallbackInfo<v8::Value>& info, void (*hash_fn)(const char* const*, char* const*, const uint32_t*, uint32_t)) {
+
+    if (info.Length() < 1)
+        return THROW_ERROR_EXCEPTION("You must provide one argument.");
+
+    if (!info[0]->IsArray())
+        return THROW_ERROR_EXCEPTION("Argument should be an array of buffer objects.");
+
+    Local<Array> inputs = Local<Array>::Cast(info[0]);
+    uint32_t count = inputs->Length();
+    Local<Array> results = Nan::New<Array>(count);
+
+    for (uint32_t i = 0; i < count; i += CN_MAX_WAYS) {
+        const char * input[CN_MAX_WAYS];
+        char * output[CN_MAX_WAYS];
+        char output_data[CN_MAX_WAYS][32];
+        uint32_t input_len[CN_MAX_WAYS];
+        uint32_t ways = count - i < CN_MAX_WAYS ? count - i : CN_MAX_WAYS;
+
+        for (uint32_t w = 0; w < ways; w++) {
+            Local<Value> target = Nan::Get(inputs, i + w).ToLocalChecked();
+
+            if(!Buffer::HasInstance(target))
+                return THROW_ERROR_EXCEPTION("Array elements should be buffer objects.");
+
+            input[w] = Buffer::Data(target);
+            input_len[w] = Buffer::Length(target);
+            output[w] = output_data[w];
+        }
+
+        hash_fn(input, output, input_len, ways);
+
+        for (uint32_t w = 0; w < ways; w++)
+            Nan::Set(results, i + w, Nan::CopyBuffer(output[w], 32).ToLocalChecked());
+    }
+
+    info.GetReturnValue().Set(results);
+}
+
+NAN_METHOD(cryptonight_multi) {
+    hash_multi(info, cryptonight_hash_multi);
+}
+
+NAN_METHOD(cryptonight_light_multi) {
+    hash_multi(info, cryptonight_light_hash_multi);
+}
+
+NAN_METHOD(cryptonight_heavy_multi) {
+    hash_multi(info, cryptonight_heavy_hash_multi);
+}
+
+NAN_METHOD(scratchpadInfo) {
+    size_t count = cn_scratchpad_report(NULL, 0);
+    std::vector<cn_scratchpad_info> pads(count + CN_MAX_WAYS);
+
+    // Scratchpads may have been added since the first call; report what fits.
+    count = cn_scratchpad_report(pads.data(), pads.size());
+    if (count > pads.size())
+        count = pads.size();
+
+    Local<Array> results = Nan::New<Array>(count);
+    for (size_t i = 0; i < count; i++) {
+        Local<Object> pad = Nan::New<Object>();
+        if (pads[i].thread == CN_SCRATCHPAD_POOLED)
+            Nan::Set(pad, Nan::New("thread").ToLocalChecked(), Nan::Null());
+        else
+            Nan::Set(pad, Nan::New("thread").ToLocalChecked(), Nan::New<Number>(pads[i].thread));
+        Nan::Set(pad, Nan::New("way").ToLocalChecked(), Nan::New<Number>(pads[i].way));
+        Nan::Set(pad, Nan::New("size").ToLocalChecked(), Nan::New<Number>(pads[i].size));
+        Nan::Set(pad, Nan::New("pages").ToLocalChecked(), Nan::New(cn_scratchpad_pages_name(pads[i].pages)).ToLocalChecked());
+        Nan::Set(pad, Nan::New("node").ToLocalChecked(), pads[i].node < 0 ? Local<Value>(Nan::Null()) : Local<Value>(Nan::New<Number>(pads[i].node)));
+        Nan::Set(pad, Nan::New("residentNode").ToLocalChecked(), pads[i].resident_node < 0 ? Local<Value>(Nan::Null()) : Local<Value>(Nan::New<Number>(pads[i].resident_node)));
+        Nan::Set(results, i, pad);
+    }
+
+    info.GetReturnValue().Set(results);
+}
+
+// A batch of blobs hashed by several libuv pool threads (or, once started,
+// by the NUMA workers of one node) at once. Each thread pulls `chunk` blobs
+// at a time (CN_MAX_WAYS for CryptoNight) until the batch is drained, so the
+// threads' warmed up scratchpads are reused and the caller gets one callback.
+struct cn_batch {
+    Nan::Persistent<v8::Object> inputs;
+    Nan::Callback *callback;
+    void (*hash_fn)(const char* const*, char* const*, const uint32_t*, uint32_t);
+    std::vector<const char *> input;
+    std::vector<uint32_t> input_len;
+    std::vector<char *> outputs;
+    char *output;
+    char *storage;              /* blobs owned by the batch, if any */
+    uint32_t count;
+    uint32_t chunk;
+    std::atomic<uint32_t> next;
+    std::vector<uv_work_t> work;
+    size_t pending;
+    struct cn_work job;
+};
+
+static uint32_t cn_batch_run(struct cn_batch *batch) {
+    uint32_t hashes = 0;
+
+    for (;;) {
+        uint32_t start = batch->next.fetch_add(batch->chunk);
+
+        if (start >= batch->count)
+            break;
+
+        uint32_t ways = batch->count - start < batch->chunk ? batch->count - start : batch->chunk;
+        batch->hash_fn(&batch->input[start], &batch->outputs[start], &batch->input_len[start], ways);
+        hashes += ways;
+    }
+    return hashes;
+}
+
+static void cn_batch_finish(struct cn_batch *batch) {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null()
+      , v8::Local<v8::Value>(Nan::NewBuffer(batch->output, batch->count * 32, callback, NULL).ToLocalChecked())
+    };
+
+    batch->inputs.Reset();
+    free(batch->storage);
+    batch->callback->Call(2, argv);
+    delete batch->callback;
+    delete batch;
+}
+
+static void cn_batch_execute(uv_work_t *req) {
+    cn_batch_run((struct cn_batch *)req->data);
+}
+
+static void cn_batch_complete(uv_work_t *req, int status) {
+    struct cn_batch *batch = (struct cn_batch *)req->data;
+
+    if (--batch->pending == 0)
+        cn_batch_finish(batch);
+}
+
+// NUMA workers hand finished batches back to the loop through this handle.
+// It only keeps the loop alive while batches are outstanding.
+static uv_async_t workers_async;
+static uint32_t workers_outstanding = 0;
+
+static void workers_notify(void) {
+    uv_async_send(&workers_async);
+}
+
+static void workers_completed(uv_async_t *handle) {
+    struct cn_work *job;
+
+    while ((job = cn_workers_take_completed()) != NULL) {
+        if (--workers_outstanding == 0)
+            uv_unref((uv_handle_t *)&workers_async);
+        cn_batch_finish((struct cn_batch *)job->data);
+    }
+}
+
+static uint32_t cn_batch_job(struct cn_work *job) {
+    return cn_batch_run((struct cn_batch *)job->data);
+}
+
+// Reads the blobs of a batch call, buffers[] or one buffer with a stride,
+// from the first `argc` arguments. Returns an error message or NULL.
+static const char * cn_batch_inputs(const Nan::FunctionCallbackInfo<v8::Value>& info, int argc, struct cn_batch *batch) {
+    if (info[0]->IsArray()) {
+        Local<Array> inputs = Local<Array>::Cast(info[0]);
+
+        batch->count = inputs->Length();
+        for (uint32_t i = 0; i < batch->count; i++) {
+            Local<Value> blob = Nan::Get(inputs, i).ToLocalChecked();
+
+            if (!Buffer::HasInstance(blob))
+                return "Array elements should be buffer objects.";
+            batch->input.push_back(Buffer::Data(blob));
+            batch->input_len.push_back(Buffer::Length(blob));
+        }
+    } else if (Buffer::HasInstance(info[0])) {
+        if (argc < 2 || !info[1]->IsUint32() || Nan::To<uint32_t>(info[1]).FromJust() == 0)
+            return "Argument 2 should be the blob stride.";
+
+        uint32_t stride = Nan::To<uint32_t>(info[1]).FromJust();
+        const char * data = Buffer::Data(info[0]);
+        size_t len = Buffer::Length(info[0]);
+
+        if (len % stride != 0)
+            return "Buffer length should be a multiple of the stride.";
+        batch->count = len / stride;
+        for (uint32_t i = 0; i < batch->count; i++) {
+            batch->input.push_back(data + (size_t)i * stride);
+            batch->input_len.push_back(stride);
+        }
+    } else {
+        return "Argument 1 should be an array of buffers or a buffer.";
+    }
+
+    batch->output = (char *)malloc((size_t)batch->count * 32 + 1);
+    for (uint32_t i = 0; i < batch->count; i++)
+        batch->outputs.push_back(batch->output + (size_t)i * 32);
+    return NULL;
+}
+
+// Hands a parsed batch to the NUMA workers or spreads it over the libuv pool;
+// the callback is the last argument.
+static void cn_batch_queue(const Nan::FunctionCallbackInfo<v8::Value>& info, struct cn_batch *batch) {
+    // Persisting an array doesn't keep its elements alive: one replaced while
+    // the batch runs could be collected under the workers, so they hash copies
+    if (batch->storage == NULL && info[0]->IsArray()) {
+        size_t total = 0;
+
+        for (uint32_t i = 0; i < batch->count; i++)
+            total += batch->input_len[i];
+        batch->storage = (char *)malloc(total + 1);
+
+        char *copy = batch->storage;
+        for (uint32_t i = 0; i < batch->count; i++) {
+            memcpy(copy, batch->input[i], batch->input_len[i]);
+            batch->input[i] = copy;
+            copy += batch->input_len[i];
+        }
+    }
+    batch->inputs.Reset(info[0].As<v8::Object>());
+    batch->callback = new Nan::Callback(info[info.Length() - 1].As<v8::Function>());
+    batch->next = 0;
+
+    if (cn_workers_running()) {
+        batch->job.run = cn_batch_job;
+        batch->job.data = batch;
+        if (workers_outstanding++ == 0)
+            uv_ref((uv_handle_t *)&workers_async);
+        cn_workers_submit(&batch->job);
+        return;
+    }
+
+    // One work item per pool thread, but no more than there are chunks
+    uint32_t chunks = (batch->count + batch->chunk - 1) / batch->chunk;
+    uint32_t items = chunks < uv_pool_size() ? chunks : uv_pool_size();
+    if (items == 0)
+        items = 1;
+
+    batch->work.resize(items);
+    batch->pending = items;
+    for (uint32_t i = 0; i < items; i++) {
+        batch->work[i].data = batch;
+        uv_queue_work(uv_default_loop(), &batch->work[i], cn_batch_execute, cn_batch_complete);
+    }
+}
+
+// cryptonightBatch(buffers[], cb) or cryptonightBatch(buffer, stride, cb)
+NAN_METHOD(cryptonightBatch) {
+
+    if (info.Length() < 2 || !info[info.Length() - 1]->IsFunction())
+        return THROW_ERROR_EXCEPTION("You must provide the blobs and a callback.");
+
+    struct cn_batch *batch = new cn_batch();
+    const char * error = cn_batch_inputs(info, info.Length() - 1, batch);
+
+    if (error != NULL) {
+        free(batch->output);
+        delete batch;
+        return THROW_ERROR_EXCEPTION(error);
+    }
+    batch->hash_fn = cryptonight_hash_multi;
+    batch->chunk = CN_MAX_WAYS;
+    cn_batch_queue(info, batch);
+}
+
+// fastHashBatch(buffers[][, cb]) or fastHashBatch(buffer, stride[, cb]):
+// cn_fast_hash (Keccak) of every blob, 4 or 8 per permutation with AVX2 or
+// AVX-512. Without a callback the hashes are returned directly.
+NAN_METHOD(fastHashBatch) {
+
+    if (info.Length() < 1)
+        return THROW_ERROR_EXCEPTION("You must provide the blobs.");
+
+    bool async = info[info.Length() - 1]->IsFunction();
+    struct cn_batch *batch = new cn_batch();
+    const char * error = cn_batch_inputs(info, async ? info.Length() - 1 : info.Length(), batch);
+
+    if (error != NULL) {
+        free(batch->output);
+        delete batch;
+        return THROW_ERROR_EXCEPTION(error);
+    }
+    batch->hash_fn = cryptonight_fast_hash_multi;
+    batch->chunk = CN_FAST_BATCH;
+
+    if (async)
+        return cn_batch_queue(info, batch);
+
+    cryptonight_fast_hash_multi(batch->input.data(), batch->outputs.data(), batch->input_len.data(), batch->count);
+    info.GetReturnValue().Set(Nan::NewBuffer(batch->output, batch->count * 32, callback, NULL).ToLocalChecked());
+    delete batch;
+}
+
+// treeHash(hashes): CryptoNote Merkle root of the 32-byte hashes packed
+// back to back in one buffer, e.g. the transaction hashes of a block.
+NAN_METHOD(treeHash) {
+
+    if (info.Length() < 1 || !Buffer::HasInstance(info[0]))
+        return THROW_ERROR_EXCEPTION("Argument should be a buffer object.");
+
+    size_t len = Buffer::Length(info[0]);
+
+    if (len == 0 || len % HASH_SIZE != 0)
+        return THROW_ERROR_EXCEPTION("Buffer length should be a non-zero multiple of 32.");
+
+    char root[HASH_SIZE];
+    tree_hash((const char (*)[HASH_SIZE])Buffer::Data(info[0]), len / HASH_SIZE, root);
+    info.GetReturnValue().Set(Nan::CopyBuffer(root, HASH_SIZE).ToLocalChecked());
+}
+
+// MerkleTemplate(hashes): the transaction tree of a block template, built
+// over its 32-byte tx hashes packed back to back, the miner tx first. Only
+// the sibling path of the miner tx is kept, so updateCoinbase(minerTxHash)
+// gets the new root with one Keccak per tree level.
+class MerkleTemplate : public Nan::ObjectWrap {
+    public:
+        static void Init(Local<Object> target) {
+            Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+
+            tpl->SetClassName(Nan::New("MerkleTemplate").ToLocalChecked());
+            tpl->InstanceTemplate()->SetInternalFieldCount(1);
+            Nan::SetPrototypeMethod(tpl, "updateCoinbase", UpdateCoinbase);
+            Nan::SetPrototypeMethod(tpl, "root", Root);
+            Nan::SetPrototypeMethod(tpl, "depth", Depth);
+            Nan::Set(target, Nan::New("MerkleTemplate").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+        }
+
+    private:
+        MerkleTemplate(const char (*hashes)[HASH_SIZE], size_t count) {
+            depth = tree_branch(hashes, count, branch);
+            tree_hash_from_branch(branch, depth, hashes[0], root);
+        }
+
+        static NAN_METHOD(New) {
+            if (!info.IsConstructCall())
+                return THROW_ERROR_EXCEPTION("MerkleTemplate must be called with new.");
+            if (info.Length() < 1 || !Buffer::HasInstance(info[0]))
+                return THROW_ERROR_EXCEPTION("Argument should be a buffer object.");
+
+            size_t len = Buffer::Length(info[0]);
+
+            if (len == 0 || len % HASH_SIZE != 0)
+                return THROW_ERROR_EXCEPTION("Buffer length should be a non-zero multiple of 32.");
+
+            MerkleTemplate *tree = new MerkleTemplate((const char (*)[HASH_SIZE])Buffer::Data(info[0]), len / HASH_SIZE);
+            tree->Wrap(info.This());
+            info.GetReturnValue().Set(info.This());
+        }
+
+        static NAN_METHOD(UpdateCoinbase) {
+            MerkleTemplate *tree = Nan::ObjectWrap::Unwrap<MerkleTemplate>(info.Holder());
+
+            if (info.Length() < 1 || !Buffer::HasInstance(info[0]) || Buffer::Length(info[0]) != HASH_SIZE)
+                return THROW_ERROR_EXCEPTION("Argument should be a 32-byte buffer.");
+
+            tree_hash_from_branch(tree->branch, tree->depth, Buffer::Data(info[0]), tree->root);
+            info.GetReturnValue().Set(Nan::CopyBuffer(tree->root, HASH_SIZE).ToLocalChecked());
+        }
+
+        static NAN_METHOD(Root) {
+            MerkleTemplate *tree = Nan::ObjectWrap::Unwrap<MerkleTemplate>(info.Holder());
+
+            info.GetReturnValue().Set(Nan::CopyBuffer(tree->root, HASH_SIZE).ToLocalChecked());
+        }
+
+        static NAN_METHOD(Depth) {
+            MerkleTemplate *tree = Nan::ObjectWrap::Unwrap<MerkleTemplate>(info.Holder());
+
+            info.GetReturnValue().Set(Nan::New<Number>(tree->depth));
+        }
+
+        char branch[8 * sizeof(size_t)][HASH_SIZE];
+        size_t depth;
+        char root[HASH_SIZE];
+};
+
+// A nonce is a Number or the 4 bytes as they appear in the blob.
+static bool parse_nonce(Local<Value> value, uint32_t *nonce) {
+    if (value->IsUint32()) {
+        *nonce = Nan::To<uint32_t>(value).FromJust();
+        return true;
+    }
+    if (Buffer::HasInstance(value) && Buffer::Length(value) == 4) {
+        const uint8_t *b = (const uint8_t *)Buffer::Data(value);
+        *nonce = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+        return true;
+    }
+    return false;
+}
+
+// BlockTemplate(blob, reservedOffset): a block template from the daemon and
+// the offset of its reserved bytes. hash(nonce[, extraNonce]) patches both
+// into the native copy of the template and hashes the hashing blob without
+// building it again; hashBatch(nonces[, extraNonces][, cb]) does the same
+// for many shares. An extra nonce stays in place until the next one.
+class BlockTemplate : public Nan::ObjectWrap {
+    public:
+        static void Init(Local<Object> target) {
+            Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+
+            tpl->SetClassName(Nan::New("BlockTemplate").ToLocalChecked());
+            tpl->InstanceTemplate()->SetInternalFieldCount(1);
+            Nan::SetPrototypeMethod(tpl, "hash", Hash);
+            Nan::SetPrototypeMethod(tpl, "hashBatch", HashBatch);
+            Nan::SetPrototypeMethod(tpl, "blob", Blob);
+            Nan::SetPrototypeMethod(tpl, "hashingBlob", HashingBlob);
+            Nan::Set(target, Nan::New("BlockTemplate").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+        }
+
+    private:
+        ~BlockTemplate() {
+            block_template_free(&bt);
+        }
+
+        bool extra_nonce_fits(Local<Value> value) {
+            if (value->IsUndefined() || value->IsNull())
+                return true;
+            return Buffer::HasInstance(value) && Buffer::Length(value) <= bt.extra_offset + bt.extra_size - reserved_offset;
+        }
+
+        bool set_extra_nonce(Local<Value> value) {
+            if (value->IsUndefined() || value->IsNull())
+                return true;
+            return Buffer::HasInstance(value) &&
+                block_template_set_reserved(&bt, reserved_offset, (const uint8_t *)Buffer::Data(value), Buffer::Length(value));
+        }
+
+        static NAN_METHOD(New) {
+            if (!info.IsConstructCall())
+                return THROW_ERROR_EXCEPTION("BlockTemplate must be called with new.");
+            if (info.Length() < 2 || !Buffer::HasInstance(info[0]) || !info[1]->IsUint32())
+                return THROW_ERROR_EXCEPTION("You must provide the template blob and the reserved offset.");
+
+            BlockTemplate *tmpl = new BlockTemplate();
+            const char * error = block_template_init(&tmpl->bt, (const uint8_t *)Buffer::Data(info[0]), Buffer::Length(info[0]));
+
+            tmpl->reserved_offset = Nan::To<uint32_t>(info[1]).FromJust();
+            if (error == NULL && (tmpl->reserved_offset < tmpl->bt.extra_offset ||
+                                  tmpl->reserved_offset > tmpl->bt.extra_offset + tmpl->bt.extra_size))
+                error = "Reserved offset should be inside the miner transaction extra.";
+            if (error != NULL) {
+                delete tmpl;
+                return THROW_ERROR_EXCEPTION(error);
+            }
+            tmpl->Wrap(info.This());
+            info.GetReturnValue().Set(info.This());
+        }
+
+        static NAN_METHOD(Hash) {
+            BlockTemplate *tmpl = Nan::ObjectWrap::Unwrap<BlockTemplate>(info.Holder());
+            uint32_t nonce;
+            char output[32];
+
+            if (info.Length() < 1 || !parse_nonce(info[0], &nonce))
+                return THROW_ERROR_EXCEPTION("Argument 1 should be a 32-bit nonce.");
+            if (info.Length() >= 2 && !tmpl->set_extra_nonce(info[1]))
+                return THROW_ERROR_EXCEPTION("Argument 2 should be an extra nonce that fits the reserved space.");
+
+            block_template_set_nonce(&tmpl->bt, nonce);
+            cryptonight_hash((const char *)tmpl->bt.hashing_blob, output, tmpl->bt.hashing_blob_size);
+            info.GetReturnValue().Set(Nan::CopyBuffer(output, 32).ToLocalChecked());
+        }
+
+        // Patches every share into its own copy of the hashing blob, then
+        // hashes them as a batch, on this thread or on the pool with a callback.
+        // Every share is checked first, so a bad one leaves the template as it was.
+        static NAN_METHOD(HashBatch) {
+            BlockTemplate *tmpl = Nan::ObjectWrap::Unwrap<BlockTemplate>(info.Holder());
+            bool async = info.Length() >= 2 && info[info.Length() - 1]->IsFunction();
+            Local<Value> extra = info.Length() >= 2 && !info[1]->IsFunction() ? info[1] : Local<Value>(Nan::Undefined());
+
+            if (info.Length() < 1 || !info[0]->IsArray())
+                return THROW_ERROR_EXCEPTION("Argument 1 should be an array of nonces.");
+
+            Local<Array> nonces = Local<Array>::Cast(info[0]);
+            uint32_t count = nonces->Length();
+            size_t size = tmpl->bt.hashing_blob_size;
+
+            if (extra->IsArray() && Local<Array>::Cast(extra)->Length() != count)
+                return THROW_ERROR_EXCEPTION("There should be one extra nonce per nonce.");
+
+            std::vector<uint32_t> share_nonces(count);
+            for (uint32_t i = 0; i < count; i++) {
+                Local<Value> extra_nonce = extra->IsArray() ? Nan::Get(Local<Array>::Cast(extra), i).ToLocalChecked() : extra;
+
+                if (!parse_nonce(Nan::Get(nonces, i).ToLocalChecked(), &share_nonces[i]) || !tmpl->extra_nonce_fits(extra_nonce))
+                    return THROW_ERROR_EXCEPTION("Shares should be 32-bit nonces with extra nonces that fit the reserved space.");
+            }
+
+            struct cn_batch *batch = new cn_batch();
+            batch->count = count;
+            batch->storage = (char *)malloc(count * size + 1);
+            batch->output = (char *)malloc((size_t)count * 32 + 1);
+            for (uint32_t i = 0; i < count; i++) {
+                Local<Value> extra_nonce = extra->IsArray() ? Nan::Get(Local<Array>::Cast(extra), i).ToLocalChecked() : extra;
+
+                tmpl->set_extra_nonce(extra_nonce);
+                block_template_set_nonce(&tmpl->bt, share_nonces[i]);
+                memcpy(batch->storage + i * size, tmpl->bt.hashing_blob, size);
+                batch->input.push_back(batch->storage + i * size);
+                batch->input_len.push_back(size);
+                batch->outputs.push_back(batch->output + (size_t)i * 32);
+            }
+            batch->hash_fn = cryptonight_hash_multi;
+            batch->chunk = CN_MAX_WAYS;
+
+            if (async)
+                return cn_batch_queue(info, batch);
+
+            for (uint32_t start = 0; start < count; start += CN_MAX_WAYS) {
+                uint32_t ways = count - start < CN_MAX_WAYS ? count - start : CN_MAX_WAYS;
+                cryptonight_hash_multi(&batch->input[start], &batch->outputs[start], &batch->input_len[start], ways);
+            }
+            info.GetReturnValue().Set(Nan::NewBuffer(batch->output, count * 32, callback, NULL).ToLocalChecked());
+            free(batch->storage);
+            delete batch;
+        }
+
+        static NAN_METHOD(Blob) {
+            BlockTemplate *tmpl = Nan::ObjectWrap::Unwrap<BlockTemplate>(info.Holder());
+
+            info.GetReturnValue().Set(Nan::CopyBuffer((const char *)tmpl->bt.blob, tmpl->bt.size).ToLocalChecked());
+        }
+
+        static NAN_METHOD(HashingBlob) {
+            BlockTemplate *tmpl = Nan::ObjectWrap::Unwrap<BlockTemplate>(info.Holder());
+
+            info.GetReturnValue().Set(Nan::CopyBuffer((const char *)tmpl->bt.hashing_blob, tmpl->bt.hashing_blob_size).ToLocalChecked());
+        }
+
+        struct block_template bt;
+        size_t reserved_offset;
+};
+
+// target is a difficulty (Number), a 64-bit target (8 byte Buffer, compared
+// against the top 64 bits of the hash) or a full 256-bit target (32 bytes).
+static bool parse_share_target(Local<Value> value, struct share_target *target) {
+    if (value->IsNumber()) {
+        double difficulty = Nan::To<double>(value).FromJust();
+        // A fractional difficulty would be truncated to an easier target
+        if (!(difficulty >= 1 && difficulty < 18446744073709551616.0) || difficulty != (uint64_t)difficulty)
+            return false;
+        target->kind = SHARE_TARGET_DIFFICULTY;
+        target->value = (uint64_t)difficulty;
+        return true;
+    }
+    if (!Buffer::HasInstance(value))
+        return false;
+
+    const char * data = Buffer::Data(value);
+    size_t len = Buffer::Length(value);
+
+    if (len == 8) {
+        target->kind = SHARE_TARGET_64;
+        memcpy(&target->value, data, 8);
+        return true;
+    }
+    if (len == 32) {
+        target->kind = SHARE_TARGET_256;
+        memcpy(target->target, data, 32);
+        return true;
+    }
+    return false;
+}
+
+static bool parse_claimed_result(Local<Value> value, char *claimed) {
+    if (!Buffer::HasInstance(value) || Buffer::Length(value) != 32)
+        return false;
+    memcpy(claimed, Buffer::Data(value), 32);
+    return true;
+}
+
+static Local<Object> share_result(enum share_verdict verdict, const char *hash) {
+    Local<Object> result = Nan::New<Object>();
+
+    Nan::Set(result, Nan::New("verdict").ToLocalChecked(), Nan::New<Number>(verdict));
+    Nan::Set(result, Nan::New("hash").ToLocalChecked(), Nan::CopyBuffer(hash, 32).ToLocalChecked());
+    return result;
+}
+
+NAN_METHOD(validateShare) {
+    struct share_target share_target;
+    char claimed[32];
+    bool has_claimed = false;
+    char output[32];
+
+    if (info.Length() < 2)
+        return THROW_ERROR_EXCEPTION("You must provide at least two arguments.");
+
+    if (!Buffer::HasInstance(info[0]))
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a buffer object.");
+
+    if (!parse_share_target(info[1], &share_target))
+        return THROW_ERROR_EXCEPTION("Argument 2 should be a whole-number difficulty or an 8 or 32 byte target buffer.");
+
+    if (info.Length() >= 3 && !info[2]->IsUndefined() && !info[2]->IsNull()) {
+        if (!parse_claimed_result(info[2], claimed))
+            return THROW_ERROR_EXCEPTION("Argument 3 should be a 32 byte buffer.");
+        has_claimed = true;
+    }
+
+    cryptonight_hash(Buffer::Data(info[0]), output, Buffer::Length(info[0]));
+
+    enum share_verdict verdict = share_check((const uint8_t *)output, &share_target, has_claimed ? (const uint8_t *)claimed : NULL);
+    info.GetReturnValue().Set(share_result(verdict, output));
+}
+
+// Checks the hash against the share target on the main thread, where the
+// compare costs next to nothing, and hands { verdict, hash } to the callback
+class share_reply : public hash_reply {
+    public:
+        share_reply(Local<v8::Function> fn, const struct share_target &share_target, const char *claimed)
+            : hash_reply(Local<Object>(), 0), callback(fn), share_target(share_target), has_claimed(claimed != NULL) {
+            if (has_claimed)
+                memcpy(this->claimed, claimed, 32);
+        }
+
+        void done(const char *hash) {
+            enum share_verdict verdict = share_check((const uint8_t *)hash, &share_target, has_claimed ? (const uint8_t *)claimed : NULL);
+
+            v8::Local<v8::Value> argv[] = {
+                Nan::Null()
+              , share_result(verdict, hash)
+            };
+
+            callback.Call(2, argv);
+        }
+
+        void cancelled() {
+            v8::Local<v8::Value> argv[] = { cancel_error() };
+
+            callback.Call(1, argv);
+        }
+
+    private:
+        Nan::Callback callback;
+        struct share_target share_target;
+        bool has_claimed;
+        char claimed[32];
+};
+
+// validateShareAsync(blob, target[, claimedResult][, { priority, tag }], cb): a
+// block candidate can be checked with priority 'block' ahead of queued shares
+NAN_METHOD(validateShareAsync) {
+    struct share_target share_target;
+    char claimed[32];
+    bool has_claimed = false;
+    struct hash_options options = { PRIORITY_SHARE, std::string() };
+    int argc = info.Length() - 1;
+
+    if (info.Length() < 3 || !info[info.Length() - 1]->IsFunction())
+        return THROW_ERROR_EXCEPTION("You must provide a blob, a target and a callback.");
+
+    if (!Buffer::HasInstance(info[0]))
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a buffer object.");
+
+    if (!parse_share_target(info[1], &share_target))
+        return THROW_ERROR_EXCEPTION("Argument 2 should be a whole-number difficulty or an 8 or 32 byte target buffer.");
+
+    if (argc >= 3 && is_hash_options(info[argc - 1])) {
+        const char * error = parse_hash_options(info[--argc].As<v8::Object>(), &options);
+        if (error != NULL)
+            return THROW_ERROR_EXCEPTION(error);
+    }
+
+    if (argc >= 3 && !info[2]->IsUndefined() && !info[2]->IsNull()) {
+        if (!parse_claimed_result(info[2], claimed))
+            return THROW_ERROR_EXCEPTION("Argument 3 should be a 32 byte buffer.");
+        has_claimed = true;
+    }
+
+    hash_async(info[0].As<v8::Object>(), new share_reply(info[info.Length() - 1].As<v8::Function>(), share_target, has_claimed ? claimed : NULL),
+               cryptonight_hash, options);
+}
+
+// A running scanNonces. The scan threads wake the loop through `async`;
+// the job is freed once the done callback has run.
+struct scan_job {
+    struct nonce_scan scan;
+    std::vector<uint8_t> blob;
+    uv_async_t async;
+    Nan::Callback *on_share;
+    Nan::Callback *done;
+};
+
+static void scan_notify(struct nonce_scan *scan) {
+    uv_async_send(&((struct scan_job *)scan->data)->async);
+}
+
+static void scan_closed(uv_handle_t *handle) {
+    struct scan_job *job = (struct scan_job *)handle->data;
+
+    nonce_scan_destroy(&job->scan);
+    delete job->on_share;
+    delete job->done;
+    delete job;
+}
+
+static void scan_progress(uv_async_t *handle) {
+    struct scan_job *job = (struct scan_job *)handle->data;
+    struct nonce_scan_result results[64];
+    size_t n;
+    int done;
+
+    Nan::HandleScope scope;
+
+    do {
+        n = nonce_scan_take(&job->scan, results, 64, &done);
+        for (size_t i = 0; i < n; i++) {
+            v8::Local<v8::Value> argv[] = {
+                Nan::New<Number>(results[i].nonce)
+              , v8::Local<v8::Value>(Nan::CopyBuffer((const char *)results[i].hash, 32).ToLocalChecked())
+            };
+            job->on_share->Call(2, argv);
+        }
+    } while (n == 64);
+
+    if (!done)
+        return;
+
+    Local<Object> stats = Nan::New<Object>();
+    double seconds = job->scan.elapsed_ns / 1e9;
+    Nan::Set(stats, Nan::New("hashes").ToLocalChecked(), Nan::New<Number>(job->scan.hashes));
+    Nan::Set(stats, Nan::New("ns").ToLocalChecked(), Nan::New<Number>(job->scan.elapsed_ns));
+    Nan::Set(stats, Nan::New("hashrate").ToLocalChecked(), Nan::New<Number>(seconds > 0 ? job->scan.hashes / seconds : 0));
+
+    v8::Local<v8::Value> argv[] = { Nan::Null(), stats };
+    job->done->Call(2, argv);
+    uv_close((uv_handle_t *)&job->async, scan_closed);
+}
+
+// scanNonces(blob, nonceOffset, start, count, target, threads[, variant], onShare, done):
+// hashes the blob for count nonces from start on `threads` native threads
+// (0: one per CPU). onShare(nonce, hash) gets each nonce that meets the
+// target as it is found, done(err, { hashes, ns, hashrate }) comes last.
+// variant is 'cryptonight' (the default), 'cryptonight_light' or 'cryptonight_heavy'.
+NAN_METHOD(scanNonces) {
+    int argc = info.Length();
+
+    if (argc < 8 || !info[argc - 1]->IsFunction() || !info[argc - 2]->IsFunction())
+        return THROW_ERROR_EXCEPTION("You must provide blob, nonceOffset, start, count, target, threads and two callbacks.");
+    if (!Buffer::HasInstance(info[0]))
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a buffer object.");
+
+    size_t size = Buffer::Length(info[0]);
+
+    if (!info[1]->IsUint32() || (size_t)Nan::To<uint32_t>(info[1]).FromJust() + 4 > size)
+        return THROW_ERROR_EXCEPTION("Argument 2 should be the offset of a 4-byte nonce inside the blob.");
+    if (!info[2]->IsUint32())
+        return THROW_ERROR_EXCEPTION("Argument 3 should be the first nonce.");
+
+    double count = info[3]->IsNumber() ? Nan::To<double>(info[3]).FromJust() : -1;
+    if (!(count >= 0 && count <= 4294967296.0) || count != (uint64_t)count)
+        return THROW_ERROR_EXCEPTION("Argument 4 should be a nonce count up to 2^32.");
+
+    struct scan_job *job = new scan_job();
+    struct nonce_scan *scan = &job->scan;
+
+    if (!parse_share_target(info[4], &scan->target)) {
+        delete job;
+        return THROW_ERROR_EXCEPTION("Argument 5 should be a difficulty or an 8 or 32 byte target buffer.");
+    }
+    // Every scan thread holds CN_MAX_WAYS scratchpads; more threads than CPUs
+    // gains nothing and could exhaust them, which aborts the process
+    uint32_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads == 0)
+        max_threads = 1;
+    if (!info[5]->IsUint32() || Nan::To<uint32_t>(info[5]).FromJust() > max_threads) {
+        delete job;
+        return THROW_ERROR_EXCEPTION("Argument 6 should be the number of threads, at most one per CPU.");
+    }
+
+    scan->hash_multi = cryptonight_hash_multi;
+    if (argc >= 9) {
+        Nan::Utf8String variant(info[6]);
+
+        if (*variant != NULL && strcmp(*variant, "cryptonight_light") == 0)
+            scan->hash_multi = cryptonight_light_hash_multi;
+        else if (*variant != NULL && strcmp(*variant, "cryptonight_heavy") == 0)
+            scan->hash_multi = cryptonight_heavy_hash_multi;
+        else if (*variant == NULL || strcmp(*variant, "cryptonight") != 0) {
+            delete job;
+            return THROW_ERROR_EXCEPTION("Argument 7 should be cryptonight, cryptonight_light or cryptonight_heavy.");
+        }
+    }
+
+    job->blob.assign((const uint8_t *)Buffer::Data(info[0]), (const uint8_t *)Buffer::Data(info[0]) + size);
+    scan->blob = job->blob.data();
+    scan->size = size;
+    scan->nonce_offset = Nan::To<uint32_t>(info[1]).FromJust();
+    scan->start = Nan::To<uint32_t>(info[2]).FromJust();
+    scan->count = (uint64_t)count;
+    scan->threads = Nan::To<uint32_t>(info[5]).FromJust();
+    if (scan->threads == 0)
+        scan->threads = max_threads;
+    scan->notify = scan_notify;
+    scan->data = job;
+    job->on_share = new Nan::Callback(info[argc - 2].As<v8::Function>());
+    job->done = new Nan::Callback(info[argc - 1].As<v8::Function>());
+
+    uv_async_init(uv_default_loop(), &job->async, scan_progress);
+    job->async.data = job;
+    if (!nonce_scan_start(scan)) {
+        uv_close((uv_handle_t *)&job->async, scan_closed);
+        return THROW_ERROR_EXCEPTION("Could not start the scan threads.");
+    }
+}
+
+// startWorkers([perNode]): moves cryptonightBatch onto pinned per-node workers
+NAN_METHOD(startWorkers) {
+    uint32_t per_node = 0;
+
+    if (info.Length() >= 1 && !info[0]->IsUndefined()) {
+        if (!info[0]->IsUint32())
+            return THROW_ERROR_EXCEPTION("Argument 1 should be the number of workers per node.");
+        per_node = Nan::To<uint32_t>(info[0]).FromJust();
+    }
+
+    static bool async_ready = false;
+    if (!async_ready) {
+        uv_async_init(uv_default_loop(), &workers_async, workers_completed);
+        uv_unref((uv_handle_t *)&workers_async);
+        async_ready = true;
+    }
+
+    uint32_t workers = cn_workers_start(per_node, workers_notify);
+    if (workers == 0)
+        return THROW_ERROR_EXCEPTION("Could not start the hashing workers.");
+    info.GetReturnValue().Set(Nan::New<Number>(workers));
+}
+
+// startHashPool([threads | { threads, cpus, stackSize }]): runs CNAsync and
+// CNLAsync on the addon's own workers instead of the libuv pool. threads 0
+// (the default) starts one per CPU; worker i is pinned to cpus[i % cpus.length].
+NAN_METHOD(startHashPool) {
+    struct hash_pool_config config = { 0, NULL, 0, 0 };
+    std::vector<int> cpus;
+
+    if (info.Length() >= 1 && info[0]->IsUint32()) {
+        config.threads = Nan::To<uint32_t>(info[0]).FromJust();
+    } else if (info.Length() >= 1 && info[0]->IsObject()) {
+        Local<Object> options = info[0].As<v8::Object>();
+        Local<Value> threads = Nan::Get(options, Nan::New("threads").ToLocalChecked()).ToLocalChecked();
+        Local<Value> list = Nan::Get(options, Nan::New("cpus").ToLocalChecked()).ToLocalChecked();
+        Local<Value> stack = Nan::Get(options, Nan::New("stackSize").ToLocalChecked()).ToLocalChecked();
+
+        if (!threads->IsUndefined() && !threads->IsUint32())
+            return THROW_ERROR_EXCEPTION("threads should be a number of workers.");
+        if (!stack->IsUndefined() && !stack->IsUint32())
+            return THROW_ERROR_EXCEPTION("stackSize should be a number of bytes.");
+        if (!list->IsUndefined() && !list->IsArray())
+            return THROW_ERROR_EXCEPTION("cpus should be an array of CPU numbers.");
+        if (threads->IsUint32())
+            config.threads = Nan::To<uint32_t>(threads).FromJust();
+        if (stack->IsUint32())
+            config.stack_size = Nan::To<uint32_t>(stack).FromJust();
+        if (list->IsArray()) {
+            Local<Array> array = Local<Array>::Cast(list);
+
+            for (uint32_t i = 0; i < array->Length(); i++) {
+                Local<Value> cpu = Nan::Get(array, i).ToLocalChecked();
+
+                if (!cpu->IsUint32())
+                    return THROW_ERROR_EXCEPTION("cpus should be an array of CPU numbers.");
+                cpus.push_back(Nan::To<uint32_t>(cpu).FromJust());
+            }
+            config.cpus = cpus.data();
+            config.cpu_count = cpus.size();
+        }
+    } else if (info.Length() >= 1 && !info[0]->IsUndefined()) {
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a number of workers or an options object.");
+    }
+
+    static bool async_ready = false;
+    if (!async_ready) {
+        uv_async_init(uv_default_loop(), &hash_pool_async, hash_pool_completed);
+        uv_unref((uv_handle_t *)&hash_pool_async);
+        async_ready = true;
+    }
+
+    uint32_t threads = hash_pool_start(&config, hash_pool_notify);
+    if (threads == 0)
+        return THROW_ERROR_EXCEPTION("Could not start the hashing pool.");
+    hash_pool_threads = threads;
+    info.GetReturnValue().Set(Nan::New<Number>(threads));
+}
+
+NAN_METHOD(hashPoolStats) {
+    struct hash_pool_stats stats;
+
+    hash_pool_report(&stats);
+
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New("threads").ToLocalChecked(), Nan::New<Number>(stats.threads));
+    Nan::Set(result, Nan::New("submitted").ToLocalChecked(), Nan::New<Number>(stats.submitted));
+    Nan::Set(result, Nan::New("completed").ToLocalChecked(), Nan::New<Number>(stats.completed));
+    Nan::Set(result, Nan::New("stolen").ToLocalChecked(), Nan::New<Number>(stats.stolen));
+    Nan::Set(result, Nan::New("rejected").ToLocalChecked(), Nan::New<Number>(stats.rejected));
+    info.GetReturnValue().Set(result);
+}
+
+// setPriorityAging(ms): how long a queued async hash waits before it moves
+// up a priority class; 0 makes the classes strict
+NAN_METHOD(setPriorityAging) {
+    if (info.Length() < 1 || !info[0]->IsUint32())
+        return THROW_ERROR_EXCEPTION("Argument 1 should be a number of milliseconds.");
+    hash_queue.aging = Nan::To<uint32_t>(info[0]).FromJust();
+}
+
+NAN_METHOD(hashQueueStats) {
+    Local<Object> result = Nan::New<Object>();
+
+    Nan::Set(result, Nan::New("running").ToLocalChecked(), Nan::New<Number>(hash_running));
+    Nan::Set(result, Nan::New("block").ToLocalChecked(), Nan::New<Number>(hash_queue.count[PRIORITY_BLOCK]));
+    Nan::Set(result, Nan::New("share").ToLocalChecked(), Nan::New<Number>(hash_queue.count[PRIORITY_SHARE]));
+    Nan::Set(result, Nan::New("background").ToLocalChecked(), Nan::New<Number>(hash_queue.count[PRIORITY_BACKGROUND]));
+    info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(workerStats) {
+    struct cn_node_info nodes[64];
+    uint32_t count = cn_workers_report(nodes, 64);
+
+    if (count > 64)
+        count = 64;
+
+    Local<Array> results = Nan::New<Array>(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Local<Object> node = Nan::New<Object>();
+        Nan::Set(node, Nan::New("node").ToLocalChecked(), Nan::New<Number>(nodes[i].node));
+        Nan::Set(node, Nan::New("cpus").ToLocalChecked(), Nan::New<Number>(nodes[i].cpus));
+        Nan::Set(node, Nan::New("workers").ToLocalChecked(), Nan::New<Number>(nodes[i].workers));
+        Nan::Set(node, Nan::New("jobs").ToLocalChecked(), Nan::New<Number>(nodes[i].jobs));
+        Nan::Set(node, Nan::New("hashes").ToLocalChecked(), Nan::New<Number>(nodes[i].hashes));
+        Nan::Set(node, Nan::New("busyNs").ToLocalChecked(), Nan::New<Number>(nodes[i].busy_ns));
+        Nan::Set(results, i, node);
+    }
+    info.GetReturnValue().Set(results);
+}
+
+NAN_METHOD(enablePhaseStats) {
+    cn_stats_enable(info.Length() < 1 || info[0]->IsTrue());
+}
+
+// getPhaseStats([reset]): totals since the last reset, summed over threads
+NAN_METHOD(getPhaseStats) {
+    struct cn_phase_stats stats;
+    Local<Object> result = Nan::New<Object>();
+    Local<Object> phases = Nan::New<Object>();
+    Local<Object> finalizers = Nan::New<Object>();
+
+    cn_stats_collect(&stats);
+    if (info.Length() >= 1 && info[0]->IsTrue())
+        cn_stats_reset();
+
+    for (int i = 0; i < CN_PHASE_COUNT; i++) {
+        Local<Object> phase = Nan::New<Object>();
+        Nan::Set(phase, Nan::New("cycles").ToLocalChecked(), Nan::New<Number>(stats.cycles[i]));
+        Nan::Set(phase, Nan::New("ns").ToLocalChecked(), Nan::New<Number>(stats.ns[i]));
+        Nan::Set(phases, Nan::New(cn_phase_name(i)).ToLocalChecked(), phase);
+    }
+    for (int i = 0; i < 4; i++)
+        Nan::Set(finalizers, Nan::New(cn_finalizer_name(i)).ToLocalChecked(), Nan::New<Number>(stats.finalizer[i]));
+
+    Nan::Set(result, Nan::New("enabled").ToLocalChecked(), Nan::New<Boolean>(cn_stats_enabled != 0));
+    Nan::Set(result, Nan::New("hashes").ToLocalChecked(), Nan::New<Number>(stats.hashes));
+    Nan::Set(result, Nan::New("phases").ToLocalChecked(), phases);
+    Nan::Set(result, Nan::New("finalizers").ToLocalChecked(), finalizers);
+    info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(features) {
+    Local<Object> result = Nan::New<Object>();
+    Local<Object> cpu = Nan::New<Object>();
+    Local<Object> backends = Nan::New<Object>();
+    struct hash_dispatch_entry entries[16];
+    int count = hash_dispatch_report(entries, 16);
+
+    Nan::Set(cpu, Nan::New("ssse3").ToLocalChecked(), Nan::New<Boolean>(cpu_features.ssse3 != 0));
+    Nan::Set(cpu, Nan::New("sse41").ToLocalChecked(), Nan::New<Boolean>(cpu_features.sse41 != 0));
+    Nan::Set(cpu, Nan::New("aes").ToLocalChecked(), Nan::New<Boolean>(cpu_features.aes != 0));
+    Nan::Set(cpu, Nan::New("avx2").ToLocalChecked(), Nan::New<Boolean>(cpu_features.avx2 != 0));
+    Nan::Set(cpu, Nan::New("bmi2").ToLocalChecked(), Nan::New<Boolean>(cpu_features.bmi2 != 0));
+    Nan::Set(cpu, Nan::New("avx512f").ToLocalChecked(), Nan::New<Boolean>(cpu_features.avx512f != 0));
+    Nan::Set(cpu, Nan::New("vaes").ToLocalChecked(), Nan::New<Boolean>(cpu_features.vaes != 0));
+
+    for (int i = 0; i < count && i < 16; i++) {
+        if (entries[i].backend == NULL)
+            Nan::Set(backends, Nan::New(entries[i].algorithm).ToLocalChecked(), Nan::Null());
+        else
+            Nan::Set(backends, Nan::New(entries[i].algorithm).ToLocalChecked(), Nan::New(entries[i].backend).ToLocalChecked());
+    }
+
+    Nan::Set(result, Nan::New("level").ToLocalChecked(), Nan::New(cpu_level_name(cpu_features.level)).ToLocalChecked());
+    Nan::Set(result, Nan::New("cpu").ToLocalChecked(), cpu);
+    Nan::Set(result, Nan::New("backends").ToLocalChecked(), backends);
+    info.GetReturnValue().Set(result);
+}
+
+// Number of scratchpads to pre-fault at load: CN_SCRATCHPAD_WARMUP if set,
+// otherwise one per libuv pool thread.
+static uint32_t scratchpad_warmup_count() {
+    const char * count = getenv("CN_SCRATCHPAD_WARMUP");
+
+    if (count == NULL)
+        return uv_pool_size();
+    return strtoul(count, NULL, 10);
+}
 
 NAN_MODULE_INIT(init) {
+    cn_scratchpad_warmup(scratchpad_warmup_count());
+    prio_queue_init(&hash_queue, 1000);
+
     Nan::Set(target, Nan::New("cryptonight").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonight)).ToLocalChecked());
     Nan::Set(target, Nan::New("CNAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(CNAsync)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonightAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonightAsync)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonightLightAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonightLightAsync)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonightHeavyAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonightHeavyAsync)).ToLocalChecked());
+    Nan::Set(target, Nan::New("hashStream").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(HashStream::Create)).ToLocalChecked());
     Nan::Set(target, Nan::New("cryptonight_light").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonight_light)).ToLocalChecked());
-    Nan::Set(target, Nan::New("CNLAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(CNAsync)).ToLocalChecked());
+    Nan::Set(target, Nan::New("CNLAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(CNLAsync)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonight_multi").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonight_multi)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonight_light_multi").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonight_light_multi)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonight_heavy").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonight_heavy)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonight_heavy_multi").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonight_heavy_multi)).ToLocalChecked());
+    Nan::Set(target, Nan::New("scratchpadInfo").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(scratchpadInfo)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cryptonightBatch").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cryptonightBatch)).ToLocalChecked());
+    Nan::Set(target, Nan::New("fastHashBatch").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(fastHashBatch)).ToLocalChecked());
+    Nan::Set(target, Nan::New("treeHash").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(treeHash)).ToLocalChecked());
+    MerkleTemplate::Init(target);
+    BlockTemplate::Init(target);
+    HashStream::Init(target);
+    Nan::Set(target, Nan::New("scanNonces").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(scanNonces)).ToLocalChecked());
+    Nan::Set(target, Nan::New("validateShare").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(validateShare)).ToLocalChecked());
+    Nan::Set(target, Nan::New("validateShareAsync").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(validateShareAsync)).ToLocalChecked());
+    Nan::Set(target, Nan::New("SHARE_VALID").ToLocalChecked(), Nan::New<Number>(SHARE_VALID));
+    Nan::Set(target, Nan::New("SHARE_LOW_DIFFICULTY").ToLocalChecked(), Nan::New<Number>(SHARE_LOW_DIFFICULTY));
+    Nan::Set(target, Nan::New("SHARE_BAD_RESULT").ToLocalChecked(), Nan::New<Number>(SHARE_BAD_RESULT));
+    Nan::Set(target, Nan::New("startWorkers").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(startWorkers)).ToLocalChecked());
+    Nan::Set(target, Nan::New("workerStats").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(workerStats)).ToLocalChecked());
+    Nan::Set(target, Nan::New("startHashPool").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(startHashPool)).ToLocalChecked());
+    Nan::Set(target, Nan::New("hashPoolStats").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(hashPoolStats)).ToLocalChecked());
+    Nan::Set(target, Nan::New("setPriorityAging").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(setPriorityAging)).ToLocalChecked());
+    Nan::Set(target, Nan::New("hashQueueStats").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(hashQueueStats)).ToLocalChecked());
+    Nan::Set(target, Nan::New("cancel").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(cancel)).ToLocalChecked());
+    Nan::Set(target, Nan::New("enablePhaseStats").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(enablePhaseStats)).ToLocalChecked());
+    Nan::Set(target, Nan::New("getPhaseStats").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(getPhaseStats)).ToLocalChecked());
+    Nan::Set(target, Nan::New("features").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(features)).ToLocalChecked());
 }
 
 NODE_MODULE(multihashing, init)
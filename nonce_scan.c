@@ -0,0 +1,137 @@
+// Nonce range scanning on dedicated threads, for self-tests, solo mining
+// and measuring the sustained hash rate of a host.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cryptonight.h"
+#include "nonce_scan.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void put_nonce(uint8_t *blob, uint32_t nonce) {
+    blob[0] = (uint8_t)nonce;
+    blob[1] = (uint8_t)(nonce >> 8);
+    blob[2] = (uint8_t)(nonce >> 16);
+    blob[3] = (uint8_t)(nonce >> 24);
+}
+
+static void add_result(struct nonce_scan *scan, uint32_t nonce, const char *hash) {
+    pthread_mutex_lock(&scan->lock);
+    if (scan->result_count == scan->result_space) {
+        scan->result_space = scan->result_space ? scan->result_space * 2 : 16;
+        scan->results = realloc(scan->results, scan->result_space * sizeof(*scan->results));
+    }
+    scan->results[scan->result_count].nonce = nonce;
+    memcpy(scan->results[scan->result_count].hash, hash, 32);
+    scan->result_count++;
+    pthread_mutex_unlock(&scan->lock);
+
+    scan->notify(scan);
+}
+
+// Hashes chunks of the range until it is used up; returns the hash count
+static uint64_t scan_range(struct nonce_scan *scan, char *blobs) {
+    const char *input[CN_MAX_WAYS];
+    char hashes[CN_MAX_WAYS][32], *output[CN_MAX_WAYS];
+    uint32_t len[CN_MAX_WAYS], w;
+    uint64_t done = 0;
+
+    for (w = 0; w < CN_MAX_WAYS; w++) {
+        memcpy(blobs + w * scan->size, scan->blob, scan->size);
+        input[w] = blobs + w * scan->size;
+        output[w] = hashes[w];
+        len[w] = scan->size;
+    }
+
+    for (;;) {
+        uint64_t first = __atomic_fetch_add(&scan->next, CN_MAX_WAYS, __ATOMIC_RELAXED);
+        uint32_t ways;
+
+        if (first >= scan->count)
+            break;
+        ways = scan->count - first < CN_MAX_WAYS ? scan->count - first : CN_MAX_WAYS;
+        for (w = 0; w < ways; w++)
+            put_nonce((uint8_t *)input[w] + scan->nonce_offset, scan->start + (uint32_t)(first + w));
+        scan->hash_multi(input, output, len, ways);
+        for (w = 0; w < ways; w++) {
+            if (share_meets_target((const uint8_t *)hashes[w], &scan->target))
+                add_result(scan, scan->start + (uint32_t)(first + w), hashes[w]);
+        }
+        done += ways;
+    }
+    return done;
+}
+
+static void *scan_main(void *data) {
+    struct nonce_scan *scan = data;
+    char *blobs = malloc(scan->size * CN_MAX_WAYS);
+    // A thread without its blobs leaves the range to the others but still checks out
+    uint64_t done = blobs != NULL ? scan_range(scan, blobs) : 0;
+
+    free(blobs);
+
+    // Notify under the lock: once the owner sees `done` it may free the scan
+    pthread_mutex_lock(&scan->lock);
+    scan->hashes += done;
+    if (--scan->running == 0) {
+        scan->elapsed_ns = now_ns() - scan->started_ns;
+        scan->done = 1;
+        scan->notify(scan);
+    }
+    pthread_mutex_unlock(&scan->lock);
+    return NULL;
+}
+
+int nonce_scan_start(struct nonce_scan *scan) {
+    uint32_t i;
+
+    pthread_mutex_init(&scan->lock, NULL);
+    scan->results = NULL;
+    scan->result_count = scan->result_space = 0;
+    scan->done = 0;
+    scan->hashes = 0;
+    scan->next = 0;
+    scan->running = scan->threads ? scan->threads : 1;
+    scan->started_ns = now_ns();
+
+    // Hold the lock so no thread can finish before all are counted
+    pthread_mutex_lock(&scan->lock);
+    for (i = 0; i < scan->running; i++) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, scan_main, scan) != 0)
+            break;
+        pthread_detach(thread);
+    }
+    scan->running = i;
+    pthread_mutex_unlock(&scan->lock);
+    return i > 0;
+}
+
+size_t nonce_scan_take(struct nonce_scan *scan, struct nonce_scan_result *out, size_t max, int *done) {
+    size_t n;
+
+    pthread_mutex_lock(&scan->lock);
+    n = scan->result_count < max ? scan->result_count : max;
+    if (n > 0) {
+        memcpy(out, scan->results, n * sizeof(*out));
+        memmove(scan->results, scan->results + n, (scan->result_count - n) * sizeof(*out));
+        scan->result_count -= n;
+    }
+    *done = scan->done && scan->result_count == 0;
+    pthread_mutex_unlock(&scan->lock);
+    return n;
+}
+
+void nonce_scan_destroy(struct nonce_scan *scan) {
+    free(scan->results);
+    scan->results = NULL;
+    pthread_mutex_destroy(&scan->lock);
+}
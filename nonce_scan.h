@@ -0,0 +1,69 @@
+#ifndef NONCE_SCAN_H
+#define NONCE_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "share_check.h"
+
+struct nonce_scan_result {
+    uint32_t nonce;
+    uint8_t hash[32];
+};
+
+/*
+ * Hashes a blob for every nonce in [start, start + count) (wrapping at
+ * 2^32) on `threads` threads of its own and collects the nonces whose hash
+ * meets the target. The threads live for the whole scan, so their
+ * scratchpads stay resident, and take CN_MAX_WAYS nonces at a time.
+ */
+struct nonce_scan {
+    /* filled in by the caller */
+    const uint8_t *blob;        /* must stay valid until the scan is done */
+    size_t size;
+    size_t nonce_offset;        /* 4 little-endian bytes */
+    uint32_t start;
+    uint64_t count;             /* at most 2^32 */
+    struct share_target target;
+    void (*hash_multi)(const char* const*, char* const*, const uint32_t*, uint32_t);
+    uint32_t threads;
+    /* called from the scan threads when there are results to take or the scan is over */
+    void (*notify)(struct nonce_scan *scan);
+    void *data;                 /* caller's, untouched by the scan */
+
+    /* guarded by lock */
+    pthread_mutex_t lock;
+    struct nonce_scan_result *results;
+    size_t result_count, result_space;
+    uint32_t running;
+    int done;
+    uint64_t hashes;
+    uint64_t started_ns, elapsed_ns;
+    uint64_t next;              /* atomic */
+};
+
+/*
+ * Starts the threads. Returns 0 if none could start; nothing is running then
+ * and the scan only needs nonce_scan_destroy.
+ */
+int nonce_scan_start(struct nonce_scan *scan);
+
+/*
+ * Moves up to `max` results into `out` and returns how many. *done is set
+ * once every thread has finished and no results are left; the scan can then
+ * be freed with nonce_scan_destroy.
+ */
+size_t nonce_scan_take(struct nonce_scan *scan, struct nonce_scan_result *out, size_t max, int *done);
+
+void nonce_scan_destroy(struct nonce_scan *scan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+// Each class is an intrusive FIFO, so the oldest job of a class is at its
+// head and only the heads need to be compared: the one with the best class
+// after aging wins, the higher class on a tie.
+
+#include <stddef.h>
+
+#include "prio_queue.h"
+
+void prio_queue_init(struct prio_queue *queue, uint64_t aging) {
+    uint32_t i;
+
+    for (i = 0; i < PRIO_LEVELS; i++) {
+        queue->head[i] = NULL;
+        queue->tail[i] = NULL;
+        queue->count[i] = 0;
+    }
+    queue->aging = aging;
+}
+
+void prio_queue_push(struct prio_queue *queue, struct prio_item *item, uint32_t level, uint64_t now) {
+    item->next = NULL;
+    item->enqueued = now;
+    item->level = level;
+    if (queue->tail[level] != NULL)
+        queue->tail[level]->next = item;
+    else
+        queue->head[level] = item;
+    queue->tail[level] = item;
+    queue->count[level]++;
+}
+
+// The class item competes in at `now`
+static uint64_t prio_effective(const struct prio_queue *queue, const struct prio_item *item, uint64_t now) {
+    uint64_t boost;
+
+    if (queue->aging == 0 || now <= item->enqueued)
+        return item->level;
+    boost = (now - item->enqueued) / queue->aging;
+    return boost >= item->level ? 0 : item->level - boost;
+}
+
+struct prio_item *prio_queue_pop(struct prio_queue *queue, uint64_t now) {
+    struct prio_item *item;
+    uint64_t best_level = PRIO_LEVELS;
+    uint32_t best = PRIO_LEVELS;
+    uint32_t i;
+
+    for (i = 0; i < PRIO_LEVELS; i++) {
+        uint64_t level;
+
+        if (queue->head[i] == NULL)
+            continue;
+        level = prio_effective(queue, queue->head[i], now);
+        if (level < best_level) {
+            best_level = level;
+            best = i;
+        }
+    }
+    if (best == PRIO_LEVELS)
+        return NULL;
+
+    item = queue->head[best];
+    queue->head[best] = item->next;
+    if (queue->head[best] == NULL)
+        queue->tail[best] = NULL;
+    queue->count[best]--;
+    item->next = NULL;
+    return item;
+}
+
+size_t prio_queue_size(const struct prio_queue *queue) {
+    size_t size = 0;
+    uint32_t i;
+
+    for (i = 0; i < PRIO_LEVELS; i++)
+        size += queue->count[i];
+    return size;
+}
+
+struct prio_item *prio_queue_extract(struct prio_queue *queue, int (*match)(const struct prio_item *item, void *arg), void *arg) {
+    struct prio_item *removed = NULL;
+    struct prio_item **removed_tail = &removed;
+    uint32_t i;
+
+    for (i = 0; i < PRIO_LEVELS; i++) {
+        struct prio_item **link = &queue->head[i];
+
+        queue->tail[i] = NULL;
+        while (*link != NULL) {
+            struct prio_item *item = *link;
+
+            if (match(item, arg)) {
+                *link = item->next;
+                item->next = NULL;
+                *removed_tail = item;
+                removed_tail = &item->next;
+                queue->count[i]--;
+            } else {
+                queue->tail[i] = item;
+                link = &item->next;
+            }
+        }
+    }
+    return removed;
+}
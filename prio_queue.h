@@ -0,0 +1,54 @@
+#ifndef PRIO_QUEUE_H
+#define PRIO_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A multi-level FIFO for queued hashing jobs: class 0 goes first, then 1,
+ * and so on. With aging, a job that has waited `aging` ms counts as one
+ * class higher, and another class for every further `aging` ms, so a flood
+ * in a high class delays the lower ones but never starves them. Not
+ * thread-safe; the addon only uses it from the main thread.
+ */
+#define PRIO_LEVELS 3
+
+struct prio_item {
+    void *data;                 /* owner's, untouched by the queue */
+    struct prio_item *next;
+    uint64_t enqueued;          /* ms, the caller's clock */
+    uint32_t level;
+};
+
+struct prio_queue {
+    struct prio_item *head[PRIO_LEVELS];
+    struct prio_item *tail[PRIO_LEVELS];
+    size_t count[PRIO_LEVELS];
+    uint64_t aging;             /* ms; 0: strict priority */
+};
+
+void prio_queue_init(struct prio_queue *queue, uint64_t aging);
+
+/* Appends item to its class; level must be below PRIO_LEVELS. */
+void prio_queue_push(struct prio_queue *queue, struct prio_item *item, uint32_t level, uint64_t now);
+
+/* Takes the next job at time `now`, or NULL if the queue is empty. */
+struct prio_item *prio_queue_pop(struct prio_queue *queue, uint64_t now);
+
+size_t prio_queue_size(const struct prio_queue *queue);
+
+/*
+ * Removes every queued job that match(item, arg) accepts and returns them
+ * linked through `next`, best class first and oldest first within a class.
+ */
+struct prio_item *prio_queue_extract(struct prio_queue *queue, int (*match)(const struct prio_item *item, void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -78,6 +78,17 @@ extern "C"{
 #define USE_LE   1
 #endif
 
+/*
+ * The AES-NI permutations work on the state bytes in column order, which is
+ * how the state words sit in memory on little-endian hosts.
+ */
+#if USE_LE && (defined __x86_64__ || defined __i386__)
+#define GROESTL_AESNI   1
+#include "groestl_aesni.h"
+#else
+#define GROESTL_AESNI   0
+#endif
+
 #if USE_LE
 
 #define C32e(x)     ((SPH_C32(x) >> 24) \
@@ -2795,6 +2806,11 @@ groestl_small_core(sph_groestl_small_context *sc, const void *data, size_t len)
 		data = (const unsigned char *)data + clen;
 		len -= clen;
 		if (ptr == sizeof sc->buf) {
+#if GROESTL_AESNI
+			if (groestl_use_aesni)
+				groestl512_compress_aesni((unsigned char *)H, buf);
+			else
+#endif
 			COMPRESS_SMALL;
 #if SPH_64
 			sc->count ++;
@@ -2856,6 +2872,11 @@ groestl_small_close(sph_groestl_small_context *sc,
 #endif
 	groestl_small_core(sc, pad, pad_len);
 	READ_STATE_SMALL(sc);
+#if GROESTL_AESNI
+	if (groestl_use_aesni)
+		groestl512_output_aesni((unsigned char *)H);
+	else
+#endif
 	FINAL_SMALL;
 #if SPH_GROESTL_64
 	for (u = 0; u < 4; u ++)
@@ -2929,6 +2950,11 @@ groestl_big_core(sph_groestl_big_context *sc, const void *data, size_t len)
 		data = (const unsigned char *)data + clen;
 		len -= clen;
 		if (ptr == sizeof sc->buf) {
+#if GROESTL_AESNI
+			if (groestl_use_aesni)
+				groestl1024_compress_aesni((unsigned char *)H, buf);
+			else
+#endif
 			COMPRESS_BIG;
 #if SPH_64
 			sc->count ++;
@@ -2990,6 +3016,11 @@ groestl_big_close(sph_groestl_big_context *sc,
 #endif
 	groestl_big_core(sc, pad, pad_len);
 	READ_STATE_BIG(sc);
+#if GROESTL_AESNI
+	if (groestl_use_aesni)
+		groestl1024_output_aesni((unsigned char *)H);
+	else
+#endif
 	FINAL_BIG;
 #if SPH_GROESTL_64
 	for (u = 0; u < 8; u ++)
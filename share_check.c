@@ -0,0 +1,55 @@
+// Share target checks done next to the hash, so pools don't need bignum math in JS.
+
+#include <string.h>
+
+#include "share_check.h"
+
+static void load_words(const uint8_t *hash, uint64_t w[4]) {
+    memcpy(w, hash, 32);
+}
+
+// Same test as CryptoNote's check_hash: the 320-bit product must not carry
+// out of the low 256 bits.
+static int meets_difficulty(const uint64_t w[4], uint64_t difficulty) {
+    unsigned __int128 product;
+    uint64_t carry = 0;
+    int i;
+
+    if (difficulty == 0)
+        return 0;
+    for (i = 0; i < 4; i++) {
+        product = (unsigned __int128)w[i] * difficulty + carry;
+        carry = (uint64_t)(product >> 64);
+    }
+    return carry == 0;
+}
+
+static int meets_target256(const uint64_t w[4], const uint8_t *target) {
+    uint64_t t[4];
+    int i;
+
+    load_words(target, t);
+    for (i = 3; i >= 0; i--) {
+        if (w[i] != t[i])
+            return w[i] < t[i];
+    }
+    return 1;
+}
+
+int share_meets_target(const uint8_t *hash, const struct share_target *target) {
+    uint64_t w[4];
+
+    load_words(hash, w);
+    switch (target->kind) {
+    case SHARE_TARGET_DIFFICULTY: return meets_difficulty(w, target->value);
+    case SHARE_TARGET_64: return w[3] < target->value;
+    case SHARE_TARGET_256: return meets_target256(w, target->target);
+    }
+    return 0;
+}
+
+enum share_verdict share_check(const uint8_t *hash, const struct share_target *target, const uint8_t *claimed) {
+    if (claimed != NULL && memcmp(hash, claimed, 32) != 0)
+        return SHARE_BAD_RESULT;
+    return share_meets_target(hash, target) ? SHARE_VALID : SHARE_LOW_DIFFICULTY;
+}
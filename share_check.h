@@ -0,0 +1,38 @@
+#ifndef SHARE_CHECK_H
+#define SHARE_CHECK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum share_verdict {
+    SHARE_VALID = 0,
+    SHARE_LOW_DIFFICULTY = 1,   /* hash is above the target */
+    SHARE_BAD_RESULT = 2        /* hash differs from the one the miner claimed */
+};
+
+enum share_target_kind {
+    SHARE_TARGET_DIFFICULTY,    /* CryptoNote difficulty: hash * difficulty < 2^256 */
+    SHARE_TARGET_64,            /* top 64 bits of the hash < value (stratum style) */
+    SHARE_TARGET_256            /* full little-endian 256-bit target, hash <= target */
+};
+
+struct share_target {
+    enum share_target_kind kind;
+    uint64_t value;             /* difficulty or 64-bit target */
+    uint8_t target[32];         /* SHARE_TARGET_256 only */
+};
+
+/* Hashes are little-endian 256-bit numbers, as CryptoNote compares them. */
+int share_meets_target(const uint8_t *hash, const struct share_target *target);
+
+/* `claimed` may be NULL when the miner did not send its result. */
+enum share_verdict share_check(const uint8_t *hash, const struct share_target *target, const uint8_t *claimed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let crypto = require('crypto');
+
+let blobs = [];
+for (let i = 0; i < 23; i++){
+    blobs.push(crypto.randomBytes(76));
+}
+
+// cn_fast_hash inputs of assorted lengths, several Keccak blocks long
+let messages = [];
+for (let i = 0; i < 41; i++){
+    messages.push(crypto.randomBytes((i * 53) % 600));
+}
+
+function verify(name, results, inputs, fast){
+    let testsFailed = 0, testsPassed = 0;
+    inputs = inputs || blobs;
+    inputs.forEach(function(blob, i){
+        if (results.slice(i * 32, i * 32 + 32).toString('hex') !== multiHashing.cryptonight(blob, !!fast).toString('hex')){
+            testsFailed += 1;
+        } else {
+            testsPassed += 1;
+        }
+    });
+    if (results.length !== inputs.length * 32 || testsFailed > 0){
+        console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: ' + name);
+    } else {
+        console.log(testsPassed + ' tests passed on: ' + name);
+    }
+}
+
+multiHashing.cryptonightBatch(blobs, function(err, results){
+    verify('CN-Batch', results);
+});
+
+multiHashing.cryptonightBatch(Buffer.concat(blobs), 76, function(err, results){
+    verify('CN-Batch-Strided', results);
+});
+
+// The batch hashes copies: swapping out its elements once it's queued changes nothing
+let swapped = blobs.slice();
+multiHashing.cryptonightBatch(swapped, function(err, results){
+    verify('CN-Batch-Swapped', results);
+});
+for (let i = 0; i < swapped.length; i++){
+    swapped[i] = crypto.randomBytes(76);
+}
+
+verify('Fast-Batch', multiHashing.fastHashBatch(messages), messages, true);
+
+multiHashing.fastHashBatch(messages, function(err, results){
+    verify('Fast-Batch-Async', results, messages, true);
+});
+
+// Same batch again on the pinned per-node workers
+multiHashing.startWorkers(1);
+multiHashing.cryptonightBatch(blobs, function(err, results){
+    verify('CN-Batch-Workers', results);
+});
@@ -0,0 +1,78 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let crypto = require('crypto');
+
+function varint(value){
+    let bytes = [];
+    while (value >= 0x80){
+        bytes.push((value & 0x7f) | 0x80);
+        value = Math.floor(value / 128);
+    }
+    bytes.push(value);
+    return Buffer.from(bytes);
+}
+
+// A version 1 block: header, miner tx with a 40-byte extra, tx hashes
+let header = Buffer.concat([varint(1), varint(0), varint(1530000000), crypto.randomBytes(32), Buffer.alloc(4)]);
+let extra = crypto.randomBytes(40);
+let minerTx = Buffer.concat([varint(1), varint(60), varint(1), Buffer.from([0xff]), varint(123456),
+    varint(1), varint(1000000000), Buffer.from([0x02]), crypto.randomBytes(32), varint(extra.length), extra]);
+let txHashes = [];
+for (let i = 0; i < 6; i++){
+    txHashes.push(crypto.randomBytes(32));
+}
+let blob = Buffer.concat([header, minerTx, varint(txHashes.length)].concat(txHashes));
+let reservedOffset = header.length + minerTx.length - extra.length + 8;
+
+// What the pool did in JS: patch, rebuild the hashing blob, hash
+function expected(nonce, extraNonce){
+    extraNonce.copy(minerTx, minerTx.length - extra.length + 8);
+    let root = multiHashing.treeHash(Buffer.concat([multiHashing.cryptonight(minerTx, true)].concat(txHashes)));
+    let hashingBlob = Buffer.concat([header, root, varint(txHashes.length + 1)]);
+    hashingBlob.writeUInt32LE(nonce, 39);
+    return multiHashing.cryptonight(hashingBlob).toString('hex');
+}
+
+let testsFailed = 0, testsPassed = 0;
+function check(ok){
+    if (ok){
+        testsPassed += 1;
+    } else {
+        testsFailed += 1;
+    }
+}
+function report(){
+    if (testsFailed > 0){
+        console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: BlockTemplate');
+    } else {
+        console.log(testsPassed + ' tests passed on: BlockTemplate');
+    }
+}
+
+let template = new multiHashing.BlockTemplate(blob, reservedOffset);
+let nonces = [], extraNonces = [], hashes = [];
+for (let i = 0; i < 7; i++){
+    nonces.push(crypto.randomBytes(4).readUInt32LE(0));
+    extraNonces.push(crypto.randomBytes(4));
+    hashes.push(expected(nonces[i], extraNonces[i]));
+    check(template.hash(nonces[i], extraNonces[i]).toString('hex') === hashes[i]);
+}
+
+let batch = template.hashBatch(nonces, extraNonces);
+check(nonces.every(function(nonce, i){
+    return batch.slice(i * 32, i * 32 + 32).toString('hex') === hashes[i];
+}));
+
+// A bad share anywhere in a batch throws before the template is touched
+let before = template.blob().toString('hex');
+try {
+    template.hashBatch([nonces[0], nonces[1]], [extraNonces[0], Buffer.alloc(blob.length)]);
+    check(false);
+} catch (e) {
+    check(template.blob().toString('hex') === before);
+}
+
+template.hashBatch(nonces, extraNonces, function(err, results){
+    check(results.toString('hex') === batch.toString('hex'));
+    report();
+});
@@ -0,0 +1,49 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let fs = require('fs');
+
+// Hashes tagged with a stale job are cancelled while queued; the others
+// still hash correctly
+let lines = fs.readFileSync('cn.txt', 'utf8').split('\n').filter(function(line){ return line.length > 0; });
+let vectors = lines.map(function(line){ return line.split(' '); });
+let flood = 200, pending = 2 * flood + 1, cancelled = 0, testsFailed = 0;
+
+function finish(){
+    if (--pending > 0){
+        return;
+    }
+    if (testsFailed > 0 || cancelled === 0){
+        console.log('Cancel test failed: ' + testsFailed + ' bad results, ' + cancelled + ' cancelled');
+    } else {
+        console.log((2 * flood + 1) + ' tests passed on: CN-Cancel (' + cancelled + ' cancelled)');
+    }
+}
+
+for (let i = 0; i < flood; i++){
+    let v = vectors[i % vectors.length];
+    multiHashing.CNAsync(Buffer.from(v[1]), { tag: 'job-1' }, function(err, result){
+        if (err){
+            cancelled += err.code === 'ECANCELED' ? 1 : 0;
+            testsFailed += err.code === 'ECANCELED' ? 0 : 1;
+        } else if (result.toString('hex') !== v[0]){
+            testsFailed += 1;
+        }
+        finish();
+    });
+    multiHashing.CNAsync(Buffer.from(v[1]), { tag: 'job-2' }, function(err, result){
+        if (err || result.toString('hex') !== v[0]){
+            testsFailed += 1;
+        }
+        finish();
+    });
+}
+multiHashing.cryptonightAsync(Buffer.from(vectors[0][1]), { tag: 'job-1' }).then(function(){
+    testsFailed += 1;
+    finish();
+}, function(err){
+    testsFailed += err.code === 'ECANCELED' ? 0 : 1;
+    finish();
+});
+if (multiHashing.cancel('job-1') === 0){
+    testsFailed += 1;
+}
@@ -0,0 +1,27 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let fs = require('fs');
+
+// Same vectors as test_async.js, with CNAsync running on the addon's pool
+multiHashing.startHashPool({ threads: 2, stackSize: 1 << 20 });
+
+let lines = fs.readFileSync('cn.txt', 'utf8').split('\n').filter(function(line){ return line.length > 0; });
+let testsFailed = 0, testsPassed = 0;
+lines.forEach(function(line){
+    let line_data = line.split(' ');
+    multiHashing.CNAsync(Buffer.from(line_data[1]), function(err, result){
+        if (line_data[0] !== result.toString('hex')){
+            testsFailed += 1;
+        } else {
+            testsPassed += 1;
+        }
+        if (lines.length === testsFailed + testsPassed){
+            let stats = multiHashing.hashPoolStats();
+            if (testsFailed > 0 || stats.completed !== lines.length){
+                console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: CN-HashPool');
+            } else {
+                console.log(testsPassed + ' tests passed on: CN-HashPool');
+            }
+        }
+    });
+});
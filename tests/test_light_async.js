@@ -0,0 +1,35 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let fs = require('fs');
+
+// CNLAsync against the CryptoNight-Light vectors, on the libuv pool and then on the addon's pool
+let lines = fs.readFileSync('cryptonight_light.txt', 'utf8').split('\n').filter(function(line){ return line.length > 0; });
+
+function run(name, next){
+    let testsFailed = 0, testsPassed = 0;
+    lines.forEach(function(line){
+        let line_data = line.split(' ');
+        multiHashing.CNLAsync(Buffer.from(line_data[1]), function(err, result){
+            if (err || line_data[0] !== result.toString('hex')){
+                testsFailed += 1;
+            } else {
+                testsPassed += 1;
+            }
+            if (lines.length === testsFailed + testsPassed){
+                if (testsFailed > 0){
+                    console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: ' + name);
+                } else {
+                    console.log(testsPassed + ' tests passed on: ' + name);
+                }
+                if (next){
+                    next();
+                }
+            }
+        });
+    });
+}
+
+run('CNL-Async', function(){
+    multiHashing.startHashPool(2);
+    run('CNL-HashPool');
+});
@@ -0,0 +1,44 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let crypto = require('crypto');
+
+let hashes = {
+    'CryptoNight': {
+        'single': multiHashing.cryptonight,
+        'multi': multiHashing.cryptonight_multi
+    },
+    'CryptoNight-Light': {
+        'single': multiHashing.cryptonight_light,
+        'multi': multiHashing.cryptonight_light_multi
+    },
+    'CryptoNight-Heavy': {
+        'single': multiHashing.cryptonight_heavy,
+        'multi': multiHashing.cryptonight_heavy_multi
+    }
+};
+
+for (let hashType in hashes){
+    if (hashes.hasOwnProperty(hashType)){
+        let testsFailed = 0, testsPassed = 0;
+        // 1..7 inputs covers every ways value plus a split into two groups
+        for (let count = 1; count <= 7; count++){
+            let blobs = [];
+            for (let i = 0; i < count; i++){
+                blobs.push(crypto.randomBytes(76));
+            }
+            let results = hashes[hashType].multi(blobs);
+            blobs.forEach(function(blob, i){
+                if (results[i].toString('hex') !== hashes[hashType].single(blob).toString('hex')){
+                    testsFailed += 1;
+                } else {
+                    testsPassed += 1;
+                }
+            });
+        }
+        if (testsFailed > 0){
+            console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: ' + hashType + '-Multi');
+        } else {
+            console.log(testsPassed + ' tests passed on: ' + hashType + '-Multi');
+        }
+    }
+}
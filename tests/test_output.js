@@ -0,0 +1,53 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let fs = require('fs');
+
+// cryptonight/CNAsync writing into a caller's Buffer must give the cn.txt vectors
+let lines = fs.readFileSync('cn.txt', 'utf8').split('\n').filter(function(line){ return line.length > 0; });
+let out = Buffer.alloc(32 * lines.length + 1);
+let asyncOut = Buffer.alloc(32 * lines.length + 1);
+let testsFailed = 0, testsPassed = 0, pending = lines.length;
+
+function check(ok){
+    if (ok){
+        testsPassed += 1;
+    } else {
+        testsFailed += 1;
+    }
+}
+
+function report(){
+    if (testsFailed > 0){
+        console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: CN-Output');
+    } else {
+        console.log(testsPassed + ' tests passed on: CN-Output');
+    }
+}
+
+lines.forEach(function(line, i){
+    let line_data = line.split(' ');
+    let offset = 1 + 32 * i;
+    check(multiHashing.cryptonight(Buffer.from(line_data[1]), out, offset) === out);
+    check(out.slice(offset, offset + 32).toString('hex') === line_data[0]);
+    multiHashing.CNAsync(Buffer.from(line_data[1]), asyncOut, offset, function(err, result){
+        check(result === asyncOut);
+        check(asyncOut.slice(offset, offset + 32).toString('hex') === line_data[0]);
+        if (--pending === 0){
+            report();
+        }
+    });
+});
+
+try {
+    multiHashing.cryptonight(Buffer.from('x'), Buffer.alloc(32), 1);
+    check(false);
+} catch (e) {
+    check(true);
+}
+
+try {
+    multiHashing.CNAsync('not a buffer', function(){});
+    check(false);
+} catch (e) {
+    check(true);
+}
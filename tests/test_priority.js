@@ -0,0 +1,32 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let fs = require('fs');
+
+// A block-priority hash queued behind a flood of background hashes must
+// come back long before the flood is done, and every hash must stay right
+let lines = fs.readFileSync('cn.txt', 'utf8').split('\n').filter(function(line){ return line.length > 0; });
+let vectors = lines.map(function(line){ return line.split(' '); });
+let flood = 400, done = 0, blockAfter = -1, testsFailed = 0;
+
+multiHashing.setPriorityAging(0);
+for (let i = 0; i < flood; i++){
+    let v = vectors[i % vectors.length];
+    multiHashing.CNAsync(Buffer.from(v[1]), { priority: 'background' }, function(err, result){
+        if (result.toString('hex') !== v[0]){
+            testsFailed += 1;
+        }
+        if (++done === flood){
+            if (testsFailed > 0 || blockAfter < 0 || blockAfter > flood / 2){
+                console.log('Priority test failed: ' + testsFailed + ' bad hashes, block after ' + blockAfter + ' of ' + flood);
+            } else {
+                console.log((flood + 1) + ' tests passed on: CN-Priority');
+            }
+        }
+    });
+}
+multiHashing.CNAsync(Buffer.from(vectors[0][1]), { priority: 'block' }, function(err, result){
+    if (result.toString('hex') !== vectors[0][0]){
+        testsFailed += 1;
+    }
+    blockAfter = done;
+});
@@ -0,0 +1,42 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let fs = require('fs');
+
+// cryptonightAsync and hashStream against the cn.txt vectors
+let lines = fs.readFileSync('cn.txt', 'utf8').split('\n').filter(function(line){ return line.length > 0; });
+let vectors = lines.map(function(line){ return line.split(' '); });
+
+function report(name, failed, total){
+    if (failed > 0){
+        console.log(failed + '/' + total + ' tests failed on: ' + name);
+    } else {
+        console.log(total + ' tests passed on: ' + name);
+    }
+}
+
+async function promises(){
+    let results = await Promise.all(vectors.map(function(v){ return multiHashing.cryptonightAsync(Buffer.from(v[1])); }));
+    let failed = results.filter(function(result, i){ return result.toString('hex') !== vectors[i][0]; }).length;
+    report('CN-Promise', failed, vectors.length);
+}
+
+async function stream(){
+    let s = multiHashing.hashStream({ maxInFlight: 4 });
+    let failed = 0, i = 0;
+
+    (async function(){
+        for (let v of vectors){
+            await s.write(Buffer.from(v[1]));
+        }
+        s.end();
+    })();
+    for await (let hash of s){
+        if (hash.toString('hex') !== vectors[i][0]){
+            failed += 1;
+        }
+        i += 1;
+    }
+    report('CN-Stream', failed + vectors.length - i, vectors.length);
+}
+
+promises().then(stream);
@@ -0,0 +1,39 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let crypto = require('crypto');
+
+let blob = crypto.randomBytes(76);
+let start = 0xfffffff0, count = 40, difficulty = 4;
+
+// Every nonce the scan reports must meet the target, and it must miss none
+let expected = {};
+for (let i = 0; i < count; i++){
+    let nonce = (start + i) >>> 0;
+    let patched = Buffer.from(blob);
+    patched.writeUInt32LE(nonce, 39);
+    let hash = multiHashing.cryptonight(patched);
+    if (multiHashing.validateShare(patched, difficulty).verdict === multiHashing.SHARE_VALID){
+        expected[nonce] = hash.toString('hex');
+    }
+}
+
+let found = {};
+multiHashing.scanNonces(blob, 39, start, count, difficulty, 0, function(nonce, hash){
+    found[nonce] = hash.toString('hex');
+}, function(err, stats){
+    let ok = stats.hashes === count && JSON.stringify(Object.keys(found).sort()) === JSON.stringify(Object.keys(expected).sort()) &&
+        Object.keys(found).every(function(nonce){ return found[nonce] === expected[nonce]; });
+    if (!ok){
+        console.log('1/1 tests failed on: scanNonces');
+    } else {
+        console.log('1 tests passed on: scanNonces (' + stats.hashrate.toFixed(1) + ' H/s)');
+    }
+});
+
+// More threads than CPUs would only pile up scratchpads
+try {
+    multiHashing.scanNonces(blob, 39, 0, 1, difficulty, 100000, function(){}, function(){});
+    console.log('1/1 tests failed on: scanNonces thread limit');
+} catch (e) {
+    console.log('1 tests passed on: scanNonces thread limit');
+}
@@ -0,0 +1,74 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let crypto = require('crypto');
+
+function fastHash(data){
+    return multiHashing.cryptonight(data, true);
+}
+
+// Reference in JS, straight from CryptoNote's tree-hash.c
+function treeHash(hashes){
+    let count = hashes.length;
+    if (count === 1){
+        return hashes[0];
+    }
+    if (count === 2){
+        return fastHash(Buffer.concat(hashes));
+    }
+    let cnt = 2;
+    while (cnt < count){
+        cnt *= 2;
+    }
+    cnt /= 2;
+    let ints = hashes.slice(0, 2 * cnt - count);
+    for (let i = 2 * cnt - count; i < count; i += 2){
+        ints.push(fastHash(Buffer.concat([hashes[i], hashes[i + 1]])));
+    }
+    while (cnt > 2){
+        cnt /= 2;
+        let next = [];
+        for (let i = 0; i < cnt; i++){
+            next.push(fastHash(Buffer.concat([ints[2 * i], ints[2 * i + 1]])));
+        }
+        ints = next;
+    }
+    return fastHash(Buffer.concat(ints));
+}
+
+let testsFailed = 0, testsPassed = 0;
+[1, 2, 3, 4, 5, 7, 8, 9, 33, 64, 100, 257, 1000].forEach(function(count){
+    let hashes = [];
+    for (let i = 0; i < count; i++){
+        hashes.push(crypto.randomBytes(32));
+    }
+    if (multiHashing.treeHash(Buffer.concat(hashes)).toString('hex') !== treeHash(hashes).toString('hex')){
+        testsFailed += 1;
+    } else {
+        testsPassed += 1;
+    }
+});
+
+// Rotating the miner tx of a template must give the same root as a full rebuild
+[1, 2, 3, 4, 6, 16, 129].forEach(function(count){
+    let hashes = [];
+    for (let i = 0; i < count; i++){
+        hashes.push(crypto.randomBytes(32));
+    }
+    let tree = new multiHashing.MerkleTemplate(Buffer.concat(hashes));
+    let ok = tree.root().toString('hex') === treeHash(hashes).toString('hex');
+    for (let n = 0; n < 3; n++){
+        hashes[0] = crypto.randomBytes(32);
+        ok = ok && tree.updateCoinbase(hashes[0]).toString('hex') === treeHash(hashes).toString('hex');
+    }
+    if (!ok){
+        testsFailed += 1;
+    } else {
+        testsPassed += 1;
+    }
+});
+
+if (testsFailed > 0){
+    console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: treeHash');
+} else {
+    console.log(testsPassed + ' tests passed on: treeHash');
+}
@@ -0,0 +1,60 @@
+"use strict";
+let multiHashing = require('../build/Release/multihashing');
+let crypto = require('crypto');
+
+// Reference check in JS: CryptoNote treats the hash as a little-endian number
+function meetsDifficulty(hash, difficulty){
+    let value = BigInt('0x' + Buffer.from(hash).reverse().toString('hex'));
+    return value * BigInt(difficulty) < (1n << 256n);
+}
+
+let testsFailed = 0, testsPassed = 0;
+function check(ok){
+    if (ok){
+        testsPassed += 1;
+    } else {
+        testsFailed += 1;
+    }
+}
+
+let pending = 0;
+function report(){
+    if (pending > 0){
+        return;
+    }
+    if (testsFailed > 0){
+        console.log(testsFailed + '/' + (testsPassed + testsFailed) + ' tests failed on: validateShare');
+    } else {
+        console.log(testsPassed + ' tests passed on: validateShare');
+    }
+}
+
+for (let i = 0; i < 8; i++){
+    let blob = crypto.randomBytes(76);
+    let hash = multiHashing.cryptonight(blob);
+    let difficulty = 1 + Math.floor(Math.random() * 8);
+
+    let result = multiHashing.validateShare(blob, difficulty);
+    check(result.hash.equals(hash));
+    check((result.verdict === multiHashing.SHARE_VALID) === meetsDifficulty(hash, difficulty));
+
+    check(multiHashing.validateShare(blob, Buffer.alloc(32, 0xff)).verdict === multiHashing.SHARE_VALID);
+    check(multiHashing.validateShare(blob, Buffer.alloc(32, 0)).verdict === multiHashing.SHARE_LOW_DIFFICULTY);
+    check(multiHashing.validateShare(blob, Buffer.alloc(8, 0xff), hash).verdict === multiHashing.SHARE_VALID);
+    check(multiHashing.validateShare(blob, 1, crypto.randomBytes(32)).verdict === multiHashing.SHARE_BAD_RESULT);
+
+    pending += 1;
+    multiHashing.validateShareAsync(blob, difficulty, hash, function(err, asyncResult){
+        check(err === null && asyncResult.hash.equals(hash) && asyncResult.verdict === result.verdict);
+        pending -= 1;
+        report();
+    });
+}
+
+// A fractional difficulty must not be rounded down to an easier target
+try {
+    multiHashing.validateShare(crypto.randomBytes(76), 1.5);
+    check(false);
+} catch (e) {
+    check(true);
+}